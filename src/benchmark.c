@@ -35,17 +35,28 @@
 #include <string.h>
 #include <time.h>
 #include <ctype.h>
+#include <pthread.h>
 #include <readline/readline.h>
 #include <readline/history.h>
 #include "options.h"
 #include "error.h"
 #include <lxi.h>
+#include "profile.h"
 
 #define ID_LENGTH_MAX 65536
 
-int benchmark(char *ip, int port, int timeout, lxi_protocol_t protocol, int count, bool no_gui, double *result, void (*progress)(void))
+// Latency histogram covering 0..1000 ms in 0.1 ms buckets
+#define HISTOGRAM_BUCKETS 10000
+#define HISTOGRAM_RESOLUTION 0.1
+
+// Largest response accepted by the payload sweep (16 MB plus block header)
+#define SWEEP_RESPONSE_SIZE_MAX 0x1100000
+#define SWEEP_RECEIVE_CHUNK_SIZE 0x10000
+
+int benchmark(char *ip, int port, int timeout, lxi_protocol_t protocol, int count, bool no_gui, double *result, void (*progress)(void), double *latency)
 {
     struct timespec start, stop;
+    struct timespec request_start, request_stop;
     double elapsed_time;
     int device, i, bytes_received;
     char id[ID_LENGTH_MAX];
@@ -82,6 +93,9 @@ int benchmark(char *ip, int port, int timeout, lxi_protocol_t protocol, int coun
     // Run benchmark
     for (i=0; i<count; i++)
     {
+        if (latency != NULL)
+            clock_gettime(CLOCK_MONOTONIC, &request_start);
+
         // Get instrument ID
         lxi_send(device, command, strlen(command), timeout);
         bytes_received = lxi_receive(device, id, ID_LENGTH_MAX, timeout);
@@ -91,6 +105,15 @@ int benchmark(char *ip, int port, int timeout, lxi_protocol_t protocol, int coun
             return 1;
         }
 
+        if (latency != NULL)
+        {
+            // Record request latency in milliseconds
+            clock_gettime(CLOCK_MONOTONIC, &request_stop);
+            latency[i] =
+                (double)(request_stop.tv_sec - request_start.tv_sec)*1.0e3 +
+                (double)(request_stop.tv_nsec - request_start.tv_nsec)*1.0e-6;
+        }
+
         if (no_gui)
         {
             // Print progress
@@ -122,3 +145,310 @@ int benchmark(char *ip, int port, int timeout, lxi_protocol_t protocol, int coun
 
     return 0;
 }
+
+struct benchmark_worker_t
+{
+    pthread_t thread;
+    char *ip;
+    int port;
+    int timeout;
+    lxi_protocol_t protocol;
+    int count;
+    double latency_max;
+    unsigned int histogram[HISTOGRAM_BUCKETS];
+    int status;
+};
+
+static void *benchmark_worker(void *data)
+{
+    struct benchmark_worker_t *worker = data;
+    struct timespec request_start, request_stop;
+    double latency;
+    int device, i, bucket, bytes_received;
+    char id[ID_LENGTH_MAX];
+    char *command = "*IDN?";
+
+    if (worker->protocol == RAW)
+        command = "*IDN?\n";
+
+    // Connect - each worker drives its own session (handles are
+    // incrementing, only LXI_ERROR means failure)
+    device = lxi_connect(worker->ip, worker->port, NULL, worker->timeout, worker->protocol);
+    if (device == LXI_ERROR)
+    {
+        worker->status = 1;
+        return NULL;
+    }
+
+    for (i=0; i<worker->count; i++)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &request_start);
+
+        // Get instrument ID
+        lxi_send(device, command, strlen(command), worker->timeout);
+        bytes_received = lxi_receive(device, id, ID_LENGTH_MAX, worker->timeout);
+        if (bytes_received < 0)
+        {
+            worker->status = 1;
+            break;
+        }
+
+        // Record request latency in fixed bucket histogram (no allocation)
+        clock_gettime(CLOCK_MONOTONIC, &request_stop);
+        latency =
+            (double)(request_stop.tv_sec - request_start.tv_sec)*1.0e3 +
+            (double)(request_stop.tv_nsec - request_start.tv_nsec)*1.0e-6;
+        bucket = latency / HISTOGRAM_RESOLUTION;
+        if (bucket >= HISTOGRAM_BUCKETS)
+            bucket = HISTOGRAM_BUCKETS - 1;
+        worker->histogram[bucket]++;
+        if (latency > worker->latency_max)
+            worker->latency_max = latency;
+    }
+
+    // Disconnect
+    lxi_disconnect(device);
+
+    return NULL;
+}
+
+static double histogram_percentile(unsigned int *histogram, long total, double percentile)
+{
+    long threshold = total * percentile / 100.0 + 0.5;
+    long cumulative = 0;
+    int i;
+
+    for (i=0; i<HISTOGRAM_BUCKETS; i++)
+    {
+        cumulative += histogram[i];
+        if (cumulative >= threshold)
+            return (i + 1) * HISTOGRAM_RESOLUTION;
+    }
+
+    return HISTOGRAM_BUCKETS * HISTOGRAM_RESOLUTION;
+}
+
+int benchmark_concurrent(char *ip, int port, int timeout, lxi_protocol_t protocol, int count, int connections)
+{
+    struct timespec start, stop;
+    struct benchmark_worker_t *worker;
+    unsigned int histogram[HISTOGRAM_BUCKETS] = {0};
+    double elapsed_time, latency_max = 0;
+    long total = 0;
+    int i, j, status = 0;
+
+    // Check for required options
+    if (strlen(ip) == 0)
+    {
+        error_printf("Missing address\n");
+        exit(EXIT_FAILURE);
+    }
+
+    worker = calloc(connections, sizeof(struct benchmark_worker_t));
+    if (worker == NULL)
+    {
+        error_printf("Failed to allocate worker list\n");
+        return 1;
+    }
+
+    printf("Benchmarking by sending %d ID requests on each of %d connections. Please wait...\n", count, connections);
+
+    // Start time
+    if ( clock_gettime(CLOCK_MONOTONIC, &start) == -1 )
+    {
+        error_printf("Failed to get start time\n");
+        free(worker);
+        return 1;
+    }
+
+    // Start one worker thread per connection
+    for (i=0; i<connections; i++)
+    {
+        worker[i].ip = ip;
+        worker[i].port = port;
+        worker[i].timeout = timeout;
+        worker[i].protocol = protocol;
+        worker[i].count = count;
+        pthread_create(&worker[i].thread, NULL, benchmark_worker, &worker[i]);
+    }
+
+    // Wait for all workers to finish
+    for (i=0; i<connections; i++)
+        pthread_join(worker[i].thread, NULL);
+
+    // Stop time
+    if( clock_gettime(CLOCK_MONOTONIC, &stop) == -1 )
+    {
+        error_printf("Failed to get stop time\n");
+        free(worker);
+        return 1;
+    }
+
+    // Merge per-worker histograms
+    for (i=0; i<connections; i++)
+    {
+        if (worker[i].status != 0)
+            status = 1;
+
+        for (j=0; j<HISTOGRAM_BUCKETS; j++)
+        {
+            histogram[j] += worker[i].histogram[j];
+            total += worker[i].histogram[j];
+        }
+
+        if (worker[i].latency_max > latency_max)
+            latency_max = worker[i].latency_max;
+    }
+
+    free(worker);
+
+    if (status != 0)
+        error_printf("One or more connections failed\n");
+
+    if (total == 0)
+        return 1;
+
+    // Calculate elapsed time in seconds
+    elapsed_time =
+        (double)(stop.tv_sec - start.tv_sec) +
+        (double)(stop.tv_nsec - start.tv_nsec)*1.0e-9;
+
+    printf("Result: %.1f requests/second aggregate\n", total / elapsed_time);
+    printf("Latency: p50 = %.1f ms, p90 = %.1f ms, p99 = %.1f ms, max = %.1f ms\n",
+            histogram_percentile(histogram, total, 50),
+            histogram_percentile(histogram, total, 90),
+            histogram_percentile(histogram, total, 99),
+            latency_max);
+
+    return status;
+}
+
+// Build sweep command by substituting the %d placeholder manually (the
+// query is user input and must never be used as a printf format string)
+static void sweep_build_command(char *command, int length, const char *query, int size)
+{
+    const char *placeholder = strstr(query, "%d");
+
+    if (placeholder == NULL)
+    {
+        snprintf(command, length, "%s", query);
+        return;
+    }
+
+    snprintf(command, length, "%.*s%d%s", (int)(placeholder - query), query, size, placeholder + 2);
+}
+
+int benchmark_sweep(char *ip, int port, int timeout, int count, char *query)
+{
+    struct timespec start, stop;
+    static const int sweep_size[] = {0x400, 0x1000, 0x4000, 0x10000, 0x40000, 0x100000, 0x400000, 0x1000000};
+    static const lxi_protocol_t sweep_protocol[] = {VXI11, RAW};
+    static const char *sweep_protocol_name[] = {"vxi11", "raw"};
+    double elapsed_time;
+    long total_bytes;
+    char command[1000];
+    char *response;
+    bool sized_query;
+    int device, length, sizes, i, j, k, measured = 0, status = 0;
+
+    // Check for required options
+    if (strlen(ip) == 0)
+    {
+        error_printf("Missing address\n");
+        exit(EXIT_FAILURE);
+    }
+
+    response = malloc(SWEEP_RESPONSE_SIZE_MAX);
+    if (response == NULL)
+    {
+        error_printf("Failed to allocate receive buffer\n");
+        return 1;
+    }
+
+    // A %d placeholder in the query is substituted with each sweep size,
+    // e.g. ":SYST:COMM:ECHO? %d". Without a placeholder the query response
+    // has a fixed size and a single row is measured per protocol.
+    sized_query = (strstr(query, "%d") != NULL);
+    sizes = sized_query ? 8 : 1;
+
+    printf("protocol,payload,ms/op,MB/s\n");
+
+    for (i=0; i<2; i++)
+    {
+        for (j=0; j<sizes; j++)
+        {
+            sweep_build_command(command, sizeof(command) - 1, query, sweep_size[j]);
+            if (sweep_protocol[i] == RAW)
+                strcat(command, "\n");
+
+            // Connect (an unsupported protocol is skipped, not an error)
+            device = lxi_connect(ip, port, NULL, timeout, sweep_protocol[i]);
+            if (device != LXI_OK)
+            {
+                error_printf("Unable to connect via %s - skipping\n", sweep_protocol_name[i]);
+                break;
+            }
+
+            total_bytes = 0;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+
+            for (k=0; k<count; k++)
+            {
+                lxi_send(device, command, strlen(command), timeout);
+
+                if (sweep_protocol[i] == RAW)
+                {
+                    // Raw responses arrive unframed - receive chunks until the
+                    // newline response terminator shows up
+                    do
+                    {
+                        length = lxi_receive(device, response, SWEEP_RECEIVE_CHUNK_SIZE, timeout);
+                        if (length > 0)
+                            total_bytes += length;
+                    } while ((length > 0) && (response[length-1] != '\n'));
+                }
+                else
+                {
+                    length = lxi_receive(device, response, SWEEP_RESPONSE_SIZE_MAX, timeout);
+                    if (length > 0)
+                        total_bytes += length;
+                }
+
+                if (length < 0)
+                {
+                    error_printf("Failed to receive response\n");
+                    status = 1;
+                    break;
+                }
+            }
+
+            clock_gettime(CLOCK_MONOTONIC, &stop);
+
+            // Disconnect
+            lxi_disconnect(device);
+
+            if ((length < 0) || (total_bytes == 0))
+                continue;
+
+            // Calculate elapsed time in seconds
+            elapsed_time =
+                (double)(stop.tv_sec - start.tv_sec) +
+                (double)(stop.tv_nsec - start.tv_nsec)*1.0e-9;
+
+            printf("%s,%ld,%.3f,%.3f\n",
+                    sweep_protocol_name[i],
+                    total_bytes / count,
+                    elapsed_time * 1.0e3 / count,
+                    total_bytes / elapsed_time / 1.0e6);
+            measured++;
+        }
+    }
+
+    free(response);
+
+    // Fail only if no protocol could be measured at all
+    if (measured == 0)
+        status = 1;
+
+    return status;
+}
@@ -0,0 +1,264 @@
+/*
+ * Copyright (c) 2018  Martin Lund
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+#include <readline/readline.h>
+#include "completion.h"
+#include "error.h"
+
+#define TRIE_NODES_MAX 8192
+#define COMMAND_LENGTH_MAX 100
+
+// Compact prefix trie over the SCPI command dictionary. Nodes are
+// allocated once from a static pool and linked first-child/next-sibling
+// so completion lookups are O(prefix) with zero per-keystroke allocation.
+struct trie_node_t
+{
+    char c;
+    short child;
+    short sibling;
+    bool terminal;
+};
+
+static struct trie_node_t trie[TRIE_NODES_MAX];
+static short trie_nodes = 1; // Node 0 is the root
+
+// Dictionary of IEEE 488.2 common commands and frequently used SCPI
+// command headers
+static const char *scpi_commands[] =
+{
+    "*CLS",
+    "*ESE",
+    "*ESE?",
+    "*ESR?",
+    "*IDN?",
+    "*OPC",
+    "*OPC?",
+    "*OPT?",
+    "*RCL",
+    "*RST",
+    "*SAV",
+    "*SRE",
+    "*SRE?",
+    "*STB?",
+    "*TRG",
+    "*TST?",
+    "*WAI",
+    ":ABORt",
+    ":CALibrate?",
+    ":CONFigure:CURRent:AC",
+    ":CONFigure:CURRent:DC",
+    ":CONFigure:FREQuency",
+    ":CONFigure:RESistance",
+    ":CONFigure:VOLTage:AC",
+    ":CONFigure:VOLTage:DC",
+    ":DISPlay:DATA?",
+    ":FETCh?",
+    ":INITiate",
+    ":MEASure:CURRent:AC?",
+    ":MEASure:CURRent:DC?",
+    ":MEASure:FREQuency?",
+    ":MEASure:RESistance?",
+    ":MEASure:VOLTage:AC?",
+    ":MEASure:VOLTage:DC?",
+    ":OUTPut:STATe",
+    ":OUTPut:STATe?",
+    ":READ?",
+    ":SENSe:CURRent:DC:NPLCycles",
+    ":SENSe:VOLTage:DC:NPLCycles",
+    ":SOURce:CURRent",
+    ":SOURce:CURRent?",
+    ":SOURce:FREQuency",
+    ":SOURce:VOLTage",
+    ":SOURce:VOLTage?",
+    ":STATus:OPERation:CONDition?",
+    ":STATus:OPERation?",
+    ":STATus:PRESet",
+    ":STATus:QUEStionable?",
+    ":SYSTem:ERRor:NEXT?",
+    ":SYSTem:ERRor?",
+    ":SYSTem:PRESet",
+    ":SYSTem:VERSion?",
+    ":TRIGger:SOURce",
+    ":TRIGger:SOURce?",
+    ":WAVeform:DATA?",
+    ":WAVeform:FORMat",
+    ":WAVeform:PREamble?",
+    NULL
+};
+
+static short trie_node_new(char c)
+{
+    if (trie_nodes == TRIE_NODES_MAX)
+        return 0;
+
+    trie[trie_nodes].c = c;
+    trie[trie_nodes].child = 0;
+    trie[trie_nodes].sibling = 0;
+    trie[trie_nodes].terminal = false;
+
+    return trie_nodes++;
+}
+
+static void trie_insert(const char *command)
+{
+    short node = 0, next;
+    const char *c;
+
+    for (c = command; *c != '\0'; c++)
+    {
+        // Look for matching child (case insensitive)
+        next = trie[node].child;
+        while ((next != 0) && (tolower(trie[next].c) != tolower(*c)))
+            next = trie[next].sibling;
+
+        if (next == 0)
+        {
+            // Add new child node
+            next = trie_node_new(*c);
+            if (next == 0)
+                return; // Pool exhausted - skip remainder
+            trie[next].sibling = trie[node].child;
+            trie[node].child = next;
+        }
+
+        node = next;
+    }
+
+    trie[node].terminal = true;
+}
+
+static void trie_build(void)
+{
+    int i;
+
+    if (trie_nodes > 1)
+        return; // Already built
+
+    for (i = 0; scpi_commands[i] != NULL; i++)
+        trie_insert(scpi_commands[i]);
+}
+
+// Generate completion matches by depth first walk of the subtrie below
+// the entered prefix. State is kept in static buffers so repeated calls
+// from readline perform no allocation besides the returned match string.
+static char *completion_generator(const char *text, int state)
+{
+    static short stack[COMMAND_LENGTH_MAX];
+    static short depth[COMMAND_LENGTH_MAX];
+    static char match[2 * COMMAND_LENGTH_MAX];
+    static int stack_size;
+    static int prefix_length;
+    short node, d;
+    const char *c;
+
+    if (state == 0)
+    {
+        // Walk prefix to find subtrie root
+        node = 0;
+        for (c = text; *c != '\0'; c++)
+        {
+            node = trie[node].child;
+            while ((node != 0) && (tolower(trie[node].c) != tolower(*c)))
+                node = trie[node].sibling;
+            if (node == 0)
+                return NULL; // No command with this prefix
+        }
+
+        prefix_length = strlen(text);
+        if (prefix_length >= COMMAND_LENGTH_MAX)
+            return NULL;
+
+        strcpy(match, text);
+
+        // Seed walk with children of prefix node
+        stack_size = 0;
+        if (trie[node].child != 0)
+        {
+            stack[stack_size] = trie[node].child;
+            depth[stack_size++] = 0;
+        }
+    }
+
+    // Continue walk until next full command is found
+    while (stack_size > 0)
+    {
+        node = stack[--stack_size];
+        d = depth[stack_size];
+
+        match[prefix_length + d] = trie[node].c;
+
+        // Visit sibling at same depth later
+        if (trie[node].sibling != 0)
+        {
+            stack[stack_size] = trie[node].sibling;
+            depth[stack_size++] = d;
+        }
+
+        // Descend into children
+        if ((trie[node].child != 0) && ((prefix_length + d + 1) < COMMAND_LENGTH_MAX))
+        {
+            stack[stack_size] = trie[node].child;
+            depth[stack_size++] = d + 1;
+        }
+
+        if (trie[node].terminal)
+        {
+            match[prefix_length + d + 1] = 0;
+            return strdup(match);
+        }
+    }
+
+    return NULL;
+}
+
+static char **completion_callback(const char *text, int start, int end)
+{
+    (void)start;
+    (void)end;
+
+    // Complete SCPI commands only, never filenames
+    rl_attempted_completion_over = 1;
+
+    return rl_completion_matches(text, completion_generator);
+}
+
+void completion_enable(void)
+{
+    trie_build();
+
+    // SCPI commands contain ':', '*' and '?' so only break words on blanks
+    rl_completer_word_break_characters = " \t";
+    rl_attempted_completion_function = completion_callback;
+}
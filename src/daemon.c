@@ -0,0 +1,395 @@
+/*
+ * Copyright (c) 2018  Martin Lund
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "options.h"
+#include "error.h"
+#include "scpi.h"
+#include "daemon.h"
+#include <lxi.h>
+
+#define RESPONSE_LENGTH_MAX 0x500000
+#define SESSIONS_MAX 32
+
+// Session held open by the daemon, keyed by address, port and protocol
+struct session_t
+{
+    char ip[500];
+    int port;
+    lxi_protocol_t protocol;
+    int device;
+    bool active;
+};
+
+static struct session_t session_list[SESSIONS_MAX] = { };
+static int daemon_socket = -1;
+static char daemon_socket_path[108] = "";
+
+static void daemon_socket_path_resolve(char *path, int length)
+{
+    // Use one socket per user so daemons do not collide
+    snprintf(path, length, "/tmp/lxi-daemon-%d.sock", getuid());
+}
+
+static struct session_t *session_lookup(char *ip, int port, lxi_protocol_t protocol, int timeout)
+{
+    int i;
+
+    // Reuse existing session if available
+    for (i = 0; i < SESSIONS_MAX; i++)
+    {
+        if (session_list[i].active &&
+            (strcmp(session_list[i].ip, ip) == 0) &&
+            (session_list[i].port == port) &&
+            (session_list[i].protocol == protocol))
+            return &session_list[i];
+    }
+
+    // Find free session entry
+    for (i = 0; i < SESSIONS_MAX; i++)
+    {
+        if (!session_list[i].active)
+            break;
+    }
+
+    if (i == SESSIONS_MAX)
+    {
+        error_printf("Session list full\n");
+        return NULL;
+    }
+
+    // Create new session (handles are incrementing, only LXI_ERROR
+    // means failure)
+    session_list[i].device = lxi_connect(ip, port, NULL, timeout, protocol);
+    if (session_list[i].device == LXI_ERROR)
+    {
+        error_printf("Unable to connect to LXI device\n");
+        return NULL;
+    }
+
+    strncpy(session_list[i].ip, ip, sizeof(session_list[i].ip) - 1);
+    session_list[i].port = port;
+    session_list[i].protocol = protocol;
+    session_list[i].active = true;
+
+    return &session_list[i];
+}
+
+static void session_close(struct session_t *session)
+{
+    lxi_disconnect(session->device);
+    session->active = false;
+}
+
+static void daemon_exit(int signo)
+{
+    int i;
+
+    (void)signo;
+
+    // Close all open sessions
+    for (i = 0; i < SESSIONS_MAX; i++)
+    {
+        if (session_list[i].active)
+            session_close(&session_list[i]);
+    }
+
+    if (daemon_socket != -1)
+        close(daemon_socket);
+
+    if (strlen(daemon_socket_path) > 0)
+        unlink(daemon_socket_path);
+
+    exit(EXIT_SUCCESS);
+}
+
+static int read_line(int socket, char *buffer, int length)
+{
+    int i = 0;
+    char c;
+
+    // Read single newline terminated line from socket
+    while (i < (length - 1))
+    {
+        if (read(socket, &c, 1) != 1)
+            return -1;
+
+        if (c == '\n')
+            break;
+
+        buffer[i++] = c;
+    }
+
+    buffer[i] = 0;
+
+    return i;
+}
+
+static int write_all(int socket, const char *buffer, int length)
+{
+    int written = 0, n;
+
+    while (written < length)
+    {
+        n = write(socket, buffer + written, length - written);
+        if (n <= 0)
+            return -1;
+        written += n;
+    }
+
+    return length;
+}
+
+static void daemon_handle_request(int client_socket, char *response)
+{
+    char header[1100];
+    char command[1000];
+    char ip[500];
+    int port, timeout, protocol, command_length, length;
+    struct session_t *session;
+
+    // Request header format: "<ip> <port> <timeout> <protocol> <command-length>"
+    if (read_line(client_socket, header, sizeof(header)) < 0)
+        return;
+
+    if (sscanf(header, "%499s %d %d %d %d", ip, &port, &timeout, &protocol, &command_length) != 5)
+        return;
+
+    if ((command_length <= 0) || (command_length >= (int) sizeof(command) - 1))
+        return;
+
+    // Read command payload
+    length = 0;
+    while (length < command_length)
+    {
+        int n = read(client_socket, command + length, command_length - length);
+        if (n <= 0)
+            return;
+        length += n;
+    }
+    command[command_length] = 0;
+
+    // RAW transport requires newline terminated commands
+    if (((lxi_protocol_t) protocol == RAW) && (command[command_length-1] != '\n'))
+    {
+        command[command_length++] = '\n';
+        command[command_length] = 0;
+    }
+
+    // Look up warm session (connect on first use)
+    session = session_lookup(ip, port, (lxi_protocol_t) protocol, timeout);
+    if (session == NULL)
+    {
+        dprintf(client_socket, "%d\n", -1);
+        return;
+    }
+
+    // Send SCPI command
+    length = lxi_send(session->device, command, command_length, timeout);
+    if (length < 0)
+    {
+        // Session may be stale - reconnect and retry once
+        session_close(session);
+        session = session_lookup(ip, port, (lxi_protocol_t) protocol, timeout);
+        if (session != NULL)
+            length = lxi_send(session->device, command, command_length, timeout);
+    }
+
+    if (length < 0)
+    {
+        dprintf(client_socket, "%d\n", -1);
+        return;
+    }
+
+    // Only expect response in case we are firing a question command
+    if (question(command))
+    {
+        length = lxi_receive(session->device, response, RESPONSE_LENGTH_MAX, timeout);
+        if (length < 0)
+        {
+            dprintf(client_socket, "%d\n", -1);
+            return;
+        }
+
+        // Return response
+        dprintf(client_socket, "%d\n", length);
+        write_all(client_socket, response, length);
+    }
+    else
+        dprintf(client_socket, "%d\n", 0);
+}
+
+int daemon_start(int timeout)
+{
+    struct sockaddr_un address = { };
+    int client_socket;
+    char *response;
+
+    (void)timeout;
+
+    // Allocate shared response buffer
+    response = malloc(RESPONSE_LENGTH_MAX);
+    if (response == NULL)
+    {
+        error_printf("Failed to allocate response buffer\n");
+        return 1;
+    }
+
+    daemon_socket_path_resolve(daemon_socket_path, sizeof(daemon_socket_path));
+
+    // Create listening unix domain socket
+    daemon_socket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (daemon_socket == -1)
+    {
+        error_printf("Failed to create socket (%s)\n", strerror(errno));
+        return 1;
+    }
+
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, daemon_socket_path, sizeof(address.sun_path) - 1);
+
+    // Remove stale socket from previous daemon instance
+    unlink(daemon_socket_path);
+
+    if (bind(daemon_socket, (struct sockaddr *) &address, sizeof(address)) == -1)
+    {
+        error_printf("Failed to bind socket (%s)\n", strerror(errno));
+        return 1;
+    }
+
+    // Restrict socket access to owner - other local users must not be
+    // able to drive instruments through this daemon
+    if (chmod(daemon_socket_path, S_IRUSR | S_IWUSR) == -1)
+    {
+        error_printf("Failed to set socket permissions (%s)\n", strerror(errno));
+        return 1;
+    }
+
+    if (listen(daemon_socket, 10) == -1)
+    {
+        error_printf("Failed to listen on socket (%s)\n", strerror(errno));
+        return 1;
+    }
+
+    // Clean up sessions and socket on exit
+    signal(SIGINT, daemon_exit);
+    signal(SIGTERM, daemon_exit);
+
+    printf("Daemon listening on %s\n", daemon_socket_path);
+    printf("Holding LXI sessions open for fast 'lxi scpi' commands (ctrl-c to quit)\n");
+
+    // Serve scpi requests, one client at a time
+    while (true)
+    {
+        client_socket = accept(daemon_socket, NULL, NULL);
+        if (client_socket == -1)
+            continue;
+
+        daemon_handle_request(client_socket, response);
+        close(client_socket);
+    }
+
+    return 0;
+}
+
+int daemon_forward(char *ip, int port, int timeout, lxi_protocol_t protocol, char *command)
+{
+    struct sockaddr_un address = { };
+    char socket_path[108];
+    char header[1100];
+    char buffer[0x10000];
+    int client_socket, length, received, chunk;
+
+    daemon_socket_path_resolve(socket_path, sizeof(socket_path));
+
+    // Connect to daemon socket
+    client_socket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (client_socket == -1)
+        return -1;
+
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, socket_path, sizeof(address.sun_path) - 1);
+
+    if (connect(client_socket, (struct sockaddr *) &address, sizeof(address)) == -1)
+    {
+        // No daemon running
+        close(client_socket);
+        return -1;
+    }
+
+    // Send request header and command
+    length = strlen(command);
+    snprintf(header, sizeof(header), "%s %d %d %d %d\n", ip, port, timeout, (int) protocol, length);
+    if (write_all(client_socket, header, strlen(header)) < 0)
+        goto error;
+    if (write_all(client_socket, command, length) < 0)
+        goto error;
+
+    // Read response header
+    if (read_line(client_socket, header, sizeof(header)) < 0)
+        goto error;
+
+    length = atoi(header);
+    if (length < 0)
+        goto error;
+
+    // Stream response payload to stdout
+    received = 0;
+    while (received < length)
+    {
+        chunk = read(client_socket, buffer, sizeof(buffer));
+        if (chunk <= 0)
+            goto error;
+        fwrite(buffer, 1, chunk, stdout);
+        received += chunk;
+    }
+
+    // Append newline if printing to tty terminal (not file)
+    if ((length > 0) && isatty(fileno(stdout)) && (buffer[chunk-1] != '\n'))
+        printf("\n");
+
+    close(client_socket);
+
+    return 0;
+
+error:
+    error_printf("Daemon request failed\n");
+    close(client_socket);
+    return 1;
+}
@@ -35,11 +35,181 @@
 #include <string.h>
 #include <time.h>
 #include <ctype.h>
+#include <pthread.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "discover.h"
 #include "error.h"
 #include <lxi.h>
 
-static int device_count = 0;
-static int service_count = 0;
+#define ADDRESSES_MAX 1024
+#define ADDRESS_LENGTH_MAX 46
+#define CACHE_ID_LENGTH_MAX 256
+#define ID_LENGTH_MAX 65536
+#define SCAN_HOSTS_MAX 4094
+#define SCAN_BATCH_SIZE 256
+#define PORT_VXI11 111
+#define PORT_RAW 5025
+
+// Discovery context shared between concurrent protocol workers. The
+// liblxi callbacks carry no user pointer so results are merged through
+// this mutex protected state.
+struct discover_context_t
+{
+    int device_count;
+    int service_count;
+    char address_list[ADDRESSES_MAX][ADDRESS_LENGTH_MAX];
+    int address_count;
+    pthread_mutex_t lock;
+};
+
+static struct discover_context_t context =
+{
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+struct discover_worker_t
+{
+    lxi_discover_t type;
+    int timeout;
+};
+
+// Returns true if address was already registered (dedupes devices found
+// via multiple protocols)
+static bool address_seen(const char *address)
+{
+    int i;
+
+    for (i = 0; i < context.address_count; i++)
+    {
+        if (strcmp(context.address_list[i], address) == 0)
+            return true;
+    }
+
+    if (context.address_count < ADDRESSES_MAX)
+        strncpy(context.address_list[context.address_count++], address, ADDRESS_LENGTH_MAX - 1);
+
+    return false;
+}
+
+// Fixed size record in the on-disk discovery cache (~/.cache/lxi/discovered)
+struct cache_record_t
+{
+    char id[CACHE_ID_LENGTH_MAX];
+    char address[ADDRESS_LENGTH_MAX];
+};
+
+static int cache_filename_resolve(char *filename, int length)
+{
+    char directory[500];
+    const char *home = getenv("HOME");
+
+    if (home == NULL)
+        return -1;
+
+    // Create cache directory if missing
+    snprintf(directory, sizeof(directory), "%s/.cache", home);
+    mkdir(directory, 0755);
+    snprintf(directory, sizeof(directory), "%s/.cache/lxi", home);
+    mkdir(directory, 0755);
+
+    snprintf(filename, length, "%s/.cache/lxi/discovered", home);
+
+    return 0;
+}
+
+// Case insensitive substring search (avoids GNU strcasestr)
+static bool string_contains(const char *string, const char *substring)
+{
+    size_t i, j, string_length = strlen(string), substring_length = strlen(substring);
+
+    if (substring_length > string_length)
+        return false;
+
+    for (i = 0; i <= (string_length - substring_length); i++)
+    {
+        for (j = 0; j < substring_length; j++)
+        {
+            if (tolower(string[i+j]) != tolower(substring[j]))
+                break;
+        }
+        if (j == substring_length)
+            return true;
+    }
+
+    return false;
+}
+
+void discover_cache_add(const char *address, const char *id)
+{
+    char filename[600];
+    struct cache_record_t record;
+    FILE *fp;
+    long offset = 0;
+
+    if (cache_filename_resolve(filename, sizeof(filename)) != 0)
+        return;
+
+    fp = fopen(filename, "r+");
+    if (fp == NULL)
+        fp = fopen(filename, "w+");
+    if (fp == NULL)
+        return;
+
+    // Update existing record for this instrument if present
+    while (fread(&record, sizeof(record), 1, fp) == 1)
+    {
+        if (strncmp(record.id, id, CACHE_ID_LENGTH_MAX) == 0)
+        {
+            fseek(fp, offset, SEEK_SET);
+            break;
+        }
+        offset += sizeof(record);
+    }
+
+    memset(&record, 0, sizeof(record));
+    strncpy(record.id, id, CACHE_ID_LENGTH_MAX - 1);
+    strncpy(record.address, address, ADDRESS_LENGTH_MAX - 1);
+    fwrite(&record, sizeof(record), 1, fp);
+
+    fclose(fp);
+}
+
+int discover_cache_lookup(const char *name, char *address, int length)
+{
+    char filename[600];
+    struct cache_record_t record;
+    FILE *fp;
+
+    if (cache_filename_resolve(filename, sizeof(filename)) != 0)
+        return -1;
+
+    fp = fopen(filename, "r");
+    if (fp == NULL)
+        return -1;
+
+    // Match name as case insensitive substring of cached instrument ID
+    while (fread(&record, sizeof(record), 1, fp) == 1)
+    {
+        if (string_contains(record.id, name))
+        {
+            strncpy(address, record.address, length - 1);
+            address[length - 1] = 0;
+            fclose(fp);
+            return 0;
+        }
+    }
+
+    fclose(fp);
+
+    return -1;
+}
 
 static void broadcast(const char *address, const char *interface)
 {
@@ -48,18 +218,32 @@ static void broadcast(const char *address, const char *interface)
 
 static void device(const char *address, const char *id)
 {
-    printf("  Found \"%s\" on address %s\n", id, address);
-    device_count++;
+    pthread_mutex_lock(&context.lock);
+
+    if (!address_seen(address))
+    {
+        printf("  Found \"%s\" on address %s\n", id, address);
+        discover_cache_add(address, id);
+        context.device_count++;
+    }
+
+    pthread_mutex_unlock(&context.lock);
 }
 
 static void service(const char *address, const char *id, const char *service, int port)
 {
+    pthread_mutex_lock(&context.lock);
+
     printf("  Found \"%s\" on address %s\n    %s service on port %u\n", id, address, service, port);
-    service_count++;
+    discover_cache_add(address, id);
+    context.service_count++;
+
+    pthread_mutex_unlock(&context.lock);
 }
 
-int discover(bool mdns, int timeout)
+static void *discover_worker(void *data)
 {
+    struct discover_worker_t *worker = data;
     lxi_info_t info;
 
     // Set up info callbacks
@@ -67,25 +251,201 @@ int discover(bool mdns, int timeout)
     info.device = &device;
     info.service = &service;
 
-    printf("Searching for LXI devices - please wait...\n\n");
+    lxi_discover(&info, worker->timeout, worker->type);
 
-    // Search for LXI devices / services
-    if (mdns)
+    return NULL;
+}
+
+// Open non-blocking connect towards host:port, returns socket or -1
+static int connect_nonblocking(uint32_t host, int port)
+{
+    struct sockaddr_in address = { };
+    int fd;
+
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd == -1)
+        return -1;
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(host);
+
+    if ((connect(fd, (struct sockaddr *) &address, sizeof(address)) == -1) &&
+        (errno != EINPROGRESS))
     {
-        lxi_discover(&info, timeout, DISCOVER_MDNS);
-        if (service_count == 0)
-            printf("No services found\n");
-        else
-            printf("\nFound %d service%c\n", service_count, service_count > 1 ? 's' : ' ');
+        close(fd);
+        return -1;
     }
+
+    return fd;
+}
+
+// Query *IDN? from responsive host and report it like broadcast discovery
+static void scan_identify(uint32_t host, int port, int timeout)
+{
+    char address[ADDRESS_LENGTH_MAX];
+    char id[ID_LENGTH_MAX];
+    struct in_addr in_address = { .s_addr = htonl(host) };
+    lxi_protocol_t protocol = (port == PORT_RAW) ? RAW : VXI11;
+    char *command = (protocol == RAW) ? "*IDN?\n" : "*IDN?";
+    int instrument, length;
+
+    strncpy(address, inet_ntoa(in_address), ADDRESS_LENGTH_MAX - 1);
+    address[ADDRESS_LENGTH_MAX - 1] = 0;
+
+    instrument = lxi_connect(address, port, NULL, timeout, protocol);
+    if (instrument == LXI_ERROR)
+        return;
+
+    length = lxi_send(instrument, command, strlen(command), timeout);
+    if (length < 0)
+        goto error;
+
+    length = lxi_receive(instrument, id, ID_LENGTH_MAX, timeout);
+    if (length <= 0)
+        goto error;
+
+    // Remove trailing newline
+    if (id[length-1] == '\n')
+        id[length-1] = 0;
     else
+        id[length] = 0;
+
+    device(address, id);
+
+error:
+    lxi_disconnect(instrument);
+}
+
+int discover_subnet(const char *subnet, int timeout)
+{
+    unsigned int a, b, c, d, prefix;
+    uint32_t network, host_count, host, responsive[SCAN_HOSTS_MAX];
+    int responsive_port[SCAN_HOSTS_MAX];
+    int responsive_count = 0;
+    uint32_t i, batch_start;
+    int j;
+
+    if (sscanf(subnet, "%u.%u.%u.%u/%u", &a, &b, &c, &d, &prefix) != 5)
+    {
+        error_printf("Invalid subnet (expected format: a.b.c.d/prefix)\n");
+        return 1;
+    }
+
+    if ((a > 255) || (b > 255) || (c > 255) || (d > 255) || (prefix < 20) || (prefix > 30))
     {
-        lxi_discover(&info, timeout, DISCOVER_VXI11);
-        printf("\n");
-        if (device_count == 0)
-            printf("No devices found\n");
+        error_printf("Invalid subnet (prefix must be in range 20..30)\n");
+        return 1;
+    }
+
+    network = ((a << 24) | (b << 16) | (c << 8) | d) & (0xffffffff << (32 - prefix));
+    host_count = (1u << (32 - prefix)) - 2;
+
+    printf("Scanning %u hosts - please wait...\n\n", host_count);
+
+    // Probe VXI11 and raw ports across the range with batches of parallel
+    // non-blocking connects, harvesting readiness via poll
+    for (batch_start = 1; batch_start <= host_count; batch_start += SCAN_BATCH_SIZE)
+    {
+        struct pollfd pollfds[SCAN_BATCH_SIZE * 2];
+        uint32_t pollfd_host[SCAN_BATCH_SIZE * 2];
+        int pollfd_port[SCAN_BATCH_SIZE * 2];
+        int pollfd_count = 0;
+
+        for (i = batch_start; (i <= host_count) && (i < (batch_start + SCAN_BATCH_SIZE)); i++)
+        {
+            int port[2] = { PORT_VXI11, PORT_RAW };
+
+            host = network + i;
+
+            for (j = 0; j < 2; j++)
+            {
+                int fd = connect_nonblocking(host, port[j]);
+                if (fd == -1)
+                    continue;
+
+                pollfds[pollfd_count].fd = fd;
+                pollfds[pollfd_count].events = POLLOUT;
+                pollfd_host[pollfd_count] = host;
+                pollfd_port[pollfd_count] = port[j];
+                pollfd_count++;
+            }
+        }
+
+        poll(pollfds, pollfd_count, timeout);
+
+        for (j = 0; j < pollfd_count; j++)
+        {
+            int error = 0;
+            socklen_t error_length = sizeof(error);
+
+            if ((pollfds[j].revents & POLLOUT) &&
+                (getsockopt(pollfds[j].fd, SOL_SOCKET, SO_ERROR, &error, &error_length) == 0) &&
+                (error == 0) && (responsive_count < SCAN_HOSTS_MAX))
+            {
+                // Prefer VXI11 when host answers on both ports
+                if ((responsive_count > 0) && (responsive[responsive_count-1] == pollfd_host[j]))
+                {
+                    close(pollfds[j].fd);
+                    continue;
+                }
+
+                responsive[responsive_count] = pollfd_host[j];
+                responsive_port[responsive_count] = pollfd_port[j];
+                responsive_count++;
+            }
+
+            close(pollfds[j].fd);
+        }
+    }
+
+    // Do the *IDN? exchange on responsive hosts only
+    for (j = 0; j < responsive_count; j++)
+        scan_identify(responsive[j], responsive_port[j], timeout);
+
+    printf("\n");
+    if (context.device_count == 0)
+        printf("No devices found\n");
+    else
+        printf("Found %d device%c\n", context.device_count, context.device_count > 1 ? 's' : ' ');
+    printf("\n");
+
+    return 0;
+}
+
+int discover(bool mdns, int timeout)
+{
+    struct discover_worker_t vxi11_worker = { DISCOVER_VXI11, timeout };
+    struct discover_worker_t mdns_worker = { DISCOVER_MDNS, timeout };
+    pthread_t vxi11_thread, mdns_thread;
+
+    printf("Searching for LXI devices - please wait...\n\n");
+
+    // Search for LXI devices / services. Both protocols are probed by
+    // concurrent workers so a full sweep completes in a single timeout
+    // window.
+    pthread_create(&vxi11_thread, NULL, discover_worker, &vxi11_worker);
+    if (mdns)
+        pthread_create(&mdns_thread, NULL, discover_worker, &mdns_worker);
+
+    pthread_join(vxi11_thread, NULL);
+    if (mdns)
+        pthread_join(mdns_thread, NULL);
+
+    printf("\n");
+    if (context.device_count == 0)
+        printf("No devices found\n");
+    else
+        printf("Found %d device%c\n", context.device_count, context.device_count > 1 ? 's' : ' ');
+
+    if (mdns)
+    {
+        if (context.service_count == 0)
+            printf("No services found\n");
         else
-            printf("Found %d device%c\n", device_count, device_count > 1 ? 's' : ' ');
+            printf("Found %d service%c\n", context.service_count, context.service_count > 1 ? 's' : ' ');
     }
 
     printf("\n");
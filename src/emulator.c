@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2018  Martin Lund
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include "config.h"
+#include "options.h"
+#include "error.h"
+#include "emulator.h"
+#include <lxi.h>
+
+#define COMMAND_LENGTH_MAX 1000
+#define RESPONSE_LENGTH_MAX 1000
+#define BLOCK_SIZE_MAX 0x1000000
+
+#define EMULATOR_ID "LXI Tools,Instrument Emulator,0," VERSION
+
+static int emulator_socket = -1;
+
+// Canned response returned for unrecognized queries, configurable via
+// the :EMUL:RESP command
+static char emulator_response[RESPONSE_LENGTH_MAX] = "0";
+
+static void emulator_exit(int signo)
+{
+    (void)signo;
+
+    if (emulator_socket != -1)
+        close(emulator_socket);
+
+    exit(EXIT_SUCCESS);
+}
+
+static int read_line(int socket, char *buffer, int length)
+{
+    int i = 0;
+    char c;
+
+    // Read single newline terminated line from socket
+    while (i < (length - 1))
+    {
+        if (read(socket, &c, 1) != 1)
+            return -1;
+
+        if (c == '\n')
+            break;
+
+        buffer[i++] = c;
+    }
+
+    buffer[i] = 0;
+
+    return i;
+}
+
+static int write_all(int socket, const char *buffer, int length)
+{
+    int written = 0, n;
+
+    while (written < length)
+    {
+        n = write(socket, buffer + written, length - written);
+        if (n <= 0)
+            return -1;
+        written += n;
+    }
+
+    return length;
+}
+
+static void emulator_handle_command(int client_socket, char *command, char *block, int delay)
+{
+    char header[20];
+    char *argument;
+    long size;
+    int length;
+
+    // Strip trailing carriage return
+    length = strlen(command);
+    if ((length > 0) && (command[length-1] == '\r'))
+        command[length-1] = 0;
+
+    if (strlen(command) == 0)
+        return;
+
+    // Inject configured response latency
+    if (delay > 0)
+        usleep(delay * 1000);
+
+    // Answer identification query
+    if (strcasecmp(command, "*IDN?") == 0)
+    {
+        dprintf(client_socket, "%s\n", EMULATOR_ID);
+        return;
+    }
+
+    // Configure canned response for unrecognized queries
+    if (strncasecmp(command, ":EMUL:RESP ", 11) == 0)
+    {
+        strncpy(emulator_response, command + 11, sizeof(emulator_response) - 1);
+        return;
+    }
+
+    // Synthesize definite-length binary block of requested size
+    if ((strncasecmp(command, ":EMUL:BLOCK?", 12) == 0) ||
+        (strncasecmp(command, ":SYST:COMM:ECHO?", 16) == 0))
+    {
+        argument = strchr(command, '?') + 1;
+        size = atol(argument);
+        if (size < 1)
+            size = 1;
+        if (size > BLOCK_SIZE_MAX)
+            size = BLOCK_SIZE_MAX;
+
+        // Write "#<n><length>" block header followed by payload
+        length = snprintf(header, sizeof(header), "%ld", size);
+        dprintf(client_socket, "#%d%s", length, header);
+        write_all(client_socket, block, size);
+        dprintf(client_socket, "\n");
+        return;
+    }
+
+    // Echo canned response for any other query, ignore other commands
+    if (command[strlen(command)-1] == '?')
+        dprintf(client_socket, "%s\n", emulator_response);
+}
+
+int emulator_start(int port, int delay)
+{
+    struct sockaddr_in address = { };
+    char command[COMMAND_LENGTH_MAX];
+    char *block;
+    int client_socket, reuse = 1;
+    long i;
+
+    if (port == 0)
+        port = 5025; // Default TCP/RAW port
+
+    // Allocate shared block payload filled with recognizable pattern
+    block = malloc(BLOCK_SIZE_MAX);
+    if (block == NULL)
+    {
+        error_printf("Failed to allocate block buffer\n");
+        return 1;
+    }
+    for (i=0; i<BLOCK_SIZE_MAX; i++)
+        block[i] = 'a' + (i % 26);
+
+    // Create listening TCP socket
+    emulator_socket = socket(AF_INET, SOCK_STREAM, 0);
+    if (emulator_socket == -1)
+    {
+        error_printf("Failed to create socket (%s)\n", strerror(errno));
+        return 1;
+    }
+
+    setsockopt(emulator_socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+
+    if (bind(emulator_socket, (struct sockaddr *) &address, sizeof(address)) == -1)
+    {
+        error_printf("Failed to bind socket (%s)\n", strerror(errno));
+        return 1;
+    }
+
+    if (listen(emulator_socket, 10) == -1)
+    {
+        error_printf("Failed to listen on socket (%s)\n", strerror(errno));
+        return 1;
+    }
+
+    // Clean up socket on exit
+    signal(SIGINT, emulator_exit);
+    signal(SIGTERM, emulator_exit);
+
+    printf("Emulating raw/TCP SCPI instrument on localhost port %d (ctrl-c to quit)\n", port);
+
+    // Serve SCPI commands, one client at a time
+    while (true)
+    {
+        client_socket = accept(emulator_socket, NULL, NULL);
+        if (client_socket == -1)
+            continue;
+
+        while (read_line(client_socket, command, sizeof(command)) >= 0)
+            emulator_handle_command(client_socket, command, block, delay);
+
+        close(client_socket);
+    }
+
+    return 0;
+}
@@ -0,0 +1,74 @@
+#include "acquisitionthread.h"
+#include <QElapsedTimer>
+#include <cstdlib>
+#include <lxi.h>
+
+#define RESPONSE_LENGTH_MAX 10000
+
+void AcquisitionThread::run()
+{
+    char response[RESPONSE_LENGTH_MAX];
+    QElapsedTimer elapsed;
+    qint64 next_sample_time = 0;
+    qint64 period = 1000 / rate;
+    qint64 sleep_time;
+    Sample sample;
+    int device, length, channel;
+
+    // Acquisition runs on its own connection so it never contends with
+    // SCPI traffic issued from the GUI thread
+    device = lxi_connect(IP.toUtf8().data(), 0, NULL, timeout, VXI11);
+    if (device == LXI_ERROR)
+        return;
+
+    elapsed.start();
+
+    while (running)
+    {
+        for (channel = 0; channel < 2; channel++)
+        {
+            const QByteArray &command = (channel == 0) ? command0 : command1;
+
+            if (command.isEmpty())
+                continue;
+
+            // Retrieve sample
+            lxi_send(device, command.data(), command.length(), timeout);
+            length = lxi_receive(device, response, RESPONSE_LENGTH_MAX - 1, timeout);
+            if (length < 0)
+                continue;
+            response[length] = 0;
+
+            // Timestamp at receive time and queue sample for the GUI thread
+            sample.time = elapsed.nsecsElapsed() * 1.0e-9;
+            sample.value = atof(response);
+            sample.channel = channel;
+            buffer.push(sample);
+        }
+
+        // Pace sampling to the configured rate
+        next_sample_time += period;
+        sleep_time = next_sample_time - elapsed.elapsed();
+        if (sleep_time > 0)
+            msleep(sleep_time);
+    }
+
+    lxi_disconnect(device);
+}
+
+void AcquisitionThread::startAcquisition(const QString IP, const QString command0, const QString command1, int rate, int timeout)
+{
+    this->IP = IP;
+    this->command0 = command0.toUtf8();
+    this->command1 = command1.toUtf8();
+    this->rate = rate;
+    this->timeout = timeout;
+    this->running = true;
+    this->start();
+}
+
+void AcquisitionThread::stopAcquisition()
+{
+    running = false;
+    wait();
+}
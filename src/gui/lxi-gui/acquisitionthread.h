@@ -0,0 +1,72 @@
+#ifndef ACQUISITIONTHREAD_H
+#define ACQUISITIONTHREAD_H
+
+#include <QObject>
+#include <QThread>
+#include <QString>
+#include <QByteArray>
+#include <atomic>
+
+// One data recorder sample
+struct Sample
+{
+    double time;
+    double value;
+    int channel;
+};
+
+// Lock-free single-producer/single-consumer ring buffer. The acquisition
+// thread pushes samples, the GUI thread pops them - no locks on either side.
+class SampleRingBuffer
+{
+public:
+    static const int SIZE = 65536; // Must be power of two
+
+    bool push(const Sample &sample)
+    {
+        int head = head_.load(std::memory_order_relaxed);
+        int next = (head + 1) & (SIZE - 1);
+        if (next == tail_.load(std::memory_order_acquire))
+            return false; // Buffer full, sample dropped
+        buffer[head] = sample;
+        head_.store(next, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(Sample &sample)
+    {
+        int tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_.load(std::memory_order_acquire))
+            return false; // Buffer empty
+        sample = buffer[tail];
+        tail_.store((tail + 1) & (SIZE - 1), std::memory_order_release);
+        return true;
+    }
+
+private:
+    Sample buffer[SIZE];
+    std::atomic<int> head_ {0};
+    std::atomic<int> tail_ {0};
+};
+
+class AcquisitionThread : public QThread
+{
+    Q_OBJECT
+
+public:
+    void run() override;
+    void startAcquisition(const QString IP, const QString command0, const QString command1, int rate, int timeout);
+    void stopAcquisition();
+
+    SampleRingBuffer buffer;
+
+private:
+    QString IP;
+    QByteArray command0;
+    QByteArray command1;
+    int rate;
+    int timeout;
+    bool running = false;
+};
+
+#endif // ACQUISITIONTHREAD_H
@@ -0,0 +1,35 @@
+#include "benchmarkthread.h"
+#include <lxi.h>
+#include "../../include/benchmark.h"
+
+static BenchmarkThread *benchmark_thread;
+
+static void progress(void)
+{
+    benchmark_thread->notifyProgress();
+}
+
+void BenchmarkThread::notifyProgress()
+{
+    emit progressUpdated();
+}
+
+void BenchmarkThread::run()
+{
+    double result = 0;
+    QVector<double> latency(count);
+
+    benchmark_thread = this;
+
+    // Run benchmark, recording per request latency
+    benchmark(IP.toUtf8().data(), 0, 1000, VXI11, count, false, &result, progress, latency.data());
+
+    emit benchmarkFinished(result, latency);
+}
+
+void BenchmarkThread::startBenchmark(const QString IP, int count)
+{
+    this->IP = IP;
+    this->count = count;
+    this->start();
+}
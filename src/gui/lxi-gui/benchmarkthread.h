@@ -0,0 +1,27 @@
+#ifndef BENCHMARKTHREAD_H
+#define BENCHMARKTHREAD_H
+
+#include <QObject>
+#include <QThread>
+#include <QString>
+#include <QVector>
+
+class BenchmarkThread : public QThread
+{
+    Q_OBJECT
+
+public:
+    void run() override;
+    void startBenchmark(const QString IP, int count);
+    void notifyProgress();
+
+private:
+    QString IP;
+    int count;
+
+signals:
+    void progressUpdated();
+    void benchmarkFinished(double result, QVector<double> latency);
+};
+
+#endif // BENCHMARKTHREAD_H
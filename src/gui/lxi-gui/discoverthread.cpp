@@ -0,0 +1,45 @@
+#include "discoverthread.h"
+#include <QString>
+#include <lxi.h>
+
+static DiscoverThread *discover_thread;
+static lxi_info_t lxi_info;
+
+static void broadcast(__attribute__((unused)) const char *address, const char *interface)
+{
+    QString broadcast_message = "Broadcasting on interface " + QString(interface);
+    discover_thread->notifyStatus(broadcast_message);
+}
+
+static void device(const char *address, const char *id)
+{
+    discover_thread->notifyInstrumentFound(id, address);
+}
+
+void DiscoverThread::notifyInstrumentFound(const char *id, const char *address)
+{
+    emit instrumentFound(QString(id), QString(address));
+}
+
+void DiscoverThread::notifyStatus(QString message)
+{
+    emit statusUpdate(message);
+}
+
+void DiscoverThread::run()
+{
+    // Setup search information callbacks
+    discover_thread = this;
+    lxi_info.broadcast = &broadcast;
+    lxi_info.device = &device;
+
+    // Search for LXI devices, emitting each find as it happens
+    lxi_discover(&lxi_info, timeout, type);
+}
+
+void DiscoverThread::startDiscover(int timeout, lxi_discover_t type)
+{
+    this->timeout = timeout;
+    this->type = type;
+    this->start();
+}
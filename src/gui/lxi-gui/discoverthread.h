@@ -0,0 +1,28 @@
+#ifndef DISCOVERTHREAD_H
+#define DISCOVERTHREAD_H
+
+#include <QObject>
+#include <QThread>
+#include <QString>
+#include <lxi.h>
+
+class DiscoverThread : public QThread
+{
+    Q_OBJECT
+
+public:
+    void run() override;
+    void startDiscover(int timeout, lxi_discover_t type);
+    void notifyInstrumentFound(const char *id, const char *address);
+    void notifyStatus(QString message);
+
+private:
+    int timeout;
+    lxi_discover_t type;
+
+signals:
+    void instrumentFound(QString id, QString address);
+    void statusUpdate(QString message);
+};
+
+#endif // DISCOVERTHREAD_H
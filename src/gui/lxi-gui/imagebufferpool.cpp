@@ -0,0 +1,24 @@
+#include "imagebufferpool.h"
+#include <QMutex>
+#include <QMutexLocker>
+#include <QVector>
+
+static QMutex pool_mutex;
+static QVector<char *> pool_free_list;
+
+char *ImageBufferPool::acquire()
+{
+    QMutexLocker locker(&pool_mutex);
+
+    if (!pool_free_list.isEmpty())
+        return pool_free_list.takeLast();
+
+    return new char[IMAGE_BUFFER_SIZE];
+}
+
+void ImageBufferPool::release(char *buffer)
+{
+    QMutexLocker locker(&pool_mutex);
+
+    pool_free_list.append(buffer);
+}
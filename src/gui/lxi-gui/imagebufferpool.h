@@ -0,0 +1,18 @@
+#ifndef IMAGEBUFFERPOOL_H
+#define IMAGEBUFFERPOOL_H
+
+// Image buffer size - matches the largest capture a screenshot plugin can
+// produce (IMAGE_SIZE_MAX in screenshot.c)
+#define IMAGE_BUFFER_SIZE 0x400000 // 4 MB
+
+// Pool of heap-allocated image buffers shared between the screenshot
+// capture paths, reused across frames instead of declaring multi-megabyte
+// buffers on the stack per capture
+class ImageBufferPool
+{
+public:
+    static char *acquire();
+    static void release(char *buffer);
+};
+
+#endif // IMAGEBUFFERPOOL_H
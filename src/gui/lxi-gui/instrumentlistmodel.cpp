@@ -0,0 +1,81 @@
+#include "instrumentlistmodel.h"
+#include <algorithm>
+
+int InstrumentListModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+
+    return instrument_list.size();
+}
+
+int InstrumentListModel::columnCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+
+    return 2;
+}
+
+QVariant InstrumentListModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || (index.row() >= instrument_list.size()))
+        return QVariant();
+
+    if (role == Qt::DisplayRole)
+    {
+        if (index.column() == 0)
+            return instrument_list[index.row()].id;
+        if (index.column() == 1)
+            return instrument_list[index.row()].ip;
+    }
+
+    if ((role == Qt::TextAlignmentRole) && (index.column() == 1))
+        return Qt::AlignCenter;
+
+    return QVariant();
+}
+
+QVariant InstrumentListModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if ((orientation == Qt::Horizontal) && (role == Qt::DisplayRole))
+    {
+        if (section == 0)
+            return "Instrument ID";
+        if (section == 1)
+            return "IP Address";
+    }
+
+    return QVariant();
+}
+
+static bool instrument_less_than(const Instrument &a, const Instrument &b)
+{
+    int compare = QString::compare(a.id, b.id, Qt::CaseInsensitive);
+
+    if (compare != 0)
+        return compare < 0;
+
+    return QString::compare(a.ip, b.ip, Qt::CaseInsensitive) < 0;
+}
+
+void InstrumentListModel::addInstrument(const QString &id, const QString &ip)
+{
+    Instrument instrument = {id, ip};
+
+    // Insert at position keeping the list sorted (binary search)
+    QVector<Instrument>::iterator it =
+        std::lower_bound(instrument_list.begin(), instrument_list.end(), instrument, instrument_less_than);
+    int row = it - instrument_list.begin();
+
+    beginInsertRows(QModelIndex(), row, row);
+    instrument_list.insert(it, instrument);
+    endInsertRows();
+}
+
+void InstrumentListModel::clear()
+{
+    beginResetModel();
+    instrument_list.clear();
+    endResetModel();
+}
@@ -0,0 +1,35 @@
+#ifndef INSTRUMENTLISTMODEL_H
+#define INSTRUMENTLISTMODEL_H
+
+#include <QAbstractTableModel>
+#include <QVector>
+#include <QString>
+
+// Discovered instrument entry
+struct Instrument
+{
+    QString id;
+    QString ip;
+};
+
+// Instrument list backed by a contiguous vector kept sorted by instrument ID
+class InstrumentListModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    InstrumentListModel(QObject *parent = 0) : QAbstractTableModel(parent) {}
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role) const override;
+
+    void addInstrument(const QString &id, const QString &ip);
+    void clear();
+
+private:
+    QVector<Instrument> instrument_list;
+};
+
+#endif // INSTRUMENTLISTMODEL_H
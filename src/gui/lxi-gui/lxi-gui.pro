@@ -46,11 +46,21 @@ DEFINES += QT_DEPRECATED_WARNINGS
 SOURCES += \
         main.cpp \
         mainwindow.cpp \
-        workerthread.cpp
+        workerthread.cpp \
+        discoverthread.cpp \
+        benchmarkthread.cpp \
+        acquisitionthread.cpp \
+        imagebufferpool.cpp \
+        instrumentlistmodel.cpp
 
 HEADERS += \
         mainwindow.h \
-        workerthread.h
+        workerthread.h \
+        discoverthread.h \
+        benchmarkthread.h \
+        acquisitionthread.h \
+        imagebufferpool.h \
+        instrumentlistmodel.h
 
 FORMS += \
         mainwindow.ui
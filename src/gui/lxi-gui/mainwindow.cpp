@@ -1,6 +1,10 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 #include "workerthread.h"
+#include "discoverthread.h"
+#include "benchmarkthread.h"
+#include "acquisitionthread.h"
+#include "imagebufferpool.h"
 #include <QString>
 #include <QClipboard>
 #include <QAction>
@@ -22,9 +26,6 @@
 #include "../../include/benchmark.h"
 #include "../../include/screenshot.h"
 
-extern void lxi_discover_(int timeout, lxi_discover_t type);
-extern void benchmark_progress(void);
-
 QT_CHARTS_USE_NAMESPACE
 
 MainWindow::MainWindow(QWidget *parent) :
@@ -36,20 +37,27 @@ MainWindow::MainWindow(QWidget *parent) :
     // Create message box for error messages etc.
     messageBox = new QMessageBox(this);
 
-    // Setup instrument table widget
-    ui->tableWidget_InstrumentList->setEditTriggers(QAbstractItemView::NoEditTriggers);
-    ui->tableWidget_InstrumentList->verticalHeader()->setVisible(false);
-    ui->tableWidget_InstrumentList->setShowGrid(false);
-    ui->tableWidget_InstrumentList->setContextMenuPolicy(Qt::ActionsContextMenu);
+    // Setup instrument table view (sorted model with substring filter proxy)
+    instrument_model = new InstrumentListModel(this);
+    instrument_proxy = new QSortFilterProxyModel(this);
+    instrument_proxy->setSourceModel(instrument_model);
+    instrument_proxy->setFilterCaseSensitivity(Qt::CaseInsensitive);
+    instrument_proxy->setFilterKeyColumn(-1);
+    ui->tableView_InstrumentList->setModel(instrument_proxy);
+    ui->tableView_InstrumentList->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    ui->tableView_InstrumentList->verticalHeader()->setVisible(false);
+    ui->tableView_InstrumentList->setShowGrid(false);
+    ui->tableView_InstrumentList->setContextMenuPolicy(Qt::ActionsContextMenu);
+    connect(ui->lineEdit_InstrumentFilter, SIGNAL(textChanged(QString)), instrument_proxy, SLOT(setFilterFixedString(QString)));
     QAction* copyIDAction = new QAction("Copy ID", this);
     QAction* copyIPAction = new QAction("Copy IP", this);
     QAction* openBrowserAction = new QAction("Open in browser", this);
     connect(copyIDAction, SIGNAL(triggered()), this, SLOT(InstrumentList_copyID()));
     connect(copyIPAction, SIGNAL(triggered()), this, SLOT(InstrumentList_copyIP()));
     connect(openBrowserAction, SIGNAL(triggered()), this, SLOT(InstrumentList_openBrowser()));
-    ui->tableWidget_InstrumentList->addAction(copyIDAction);
-    ui->tableWidget_InstrumentList->addAction(copyIPAction);
-    ui->tableWidget_InstrumentList->addAction(openBrowserAction);
+    ui->tableView_InstrumentList->addAction(copyIDAction);
+    ui->tableView_InstrumentList->addAction(copyIPAction);
+    ui->tableView_InstrumentList->addAction(openBrowserAction);
 
     // Set up SCPI send action for line edit box
     lineEdit = ui->comboBox_SCPI_Command->lineEdit();
@@ -107,6 +115,9 @@ MainWindow::MainWindow(QWidget *parent) :
     ui->chartView->setChart(datarecorder_chart);
     timer = new QTimer(this);
     connect(timer, SIGNAL(timeout()), this, SLOT(DataRecorder_Update()));
+    // Re-decimate whenever the visible x range changes (zoom, rubber band,
+    // live recording advancing the axis)
+    connect(axisX, SIGNAL(rangeChanged(qreal,qreal)), this, SLOT(DataRecorder_Render()));
     data_recorder_active = false;
     data_recorder_sample_counter = 0;
     ui->chartView->setRenderHint(QPainter::Antialiasing);
@@ -127,6 +138,30 @@ MainWindow::MainWindow(QWidget *parent) :
     ui->chartView->addAction(zoomResetAction);
     ui->pushButton_DataRecorder_Save->setEnabled(false);
 
+    // Setup Benchmark page latency chart
+    benchmark_chart = new QChart();
+    benchmark_chart->legend()->hide();
+    benchmark_chart->setBackgroundVisible(false);
+    benchmark_chart->setPlotAreaBackgroundVisible(true);
+    benchmark_chart->setContentsMargins(0, 0, 0, 0);
+    benchmark_chart->setBackgroundRoundness(0);
+    benchmark_chart->setPlotAreaBackgroundBrush(brush);
+    benchmark_series = new QLineSeries();
+    benchmark_chart->addSeries(benchmark_series);
+    benchmark_axisX = new QValueAxis();
+    benchmark_axisX->setTitleText("Request");
+    benchmark_chart->setAxisX(benchmark_axisX, benchmark_series);
+    benchmark_axisX->setRange(0, 1);
+    benchmark_axisY = new QValueAxis();
+    benchmark_axisY->setTitleText("Latency [ms]");
+    benchmark_chart->setAxisY(benchmark_axisY, benchmark_series);
+    benchmark_axisY->setRange(0, 1);
+    ui->chartView_Benchmark->setChart(benchmark_chart);
+    ui->chartView_Benchmark->setRenderHint(QPainter::Antialiasing);
+
+    // Allow latency series to cross thread boundary in queued connections
+    qRegisterMetaType<QVector<double>>("QVector<double>");
+
     // Register screenshot plugins
     screenshot_register_plugins();
 }
@@ -141,16 +176,23 @@ void MainWindow::resizeEvent(QResizeEvent *event)
 // Handle resize
 void MainWindow::resize()
 {
-    ui->tableWidget_InstrumentList->setColumnWidth(0, ui->tableWidget_InstrumentList->width()*4/5);
-    ui->tableWidget_InstrumentList->setColumnWidth(1, ui->tableWidget_InstrumentList->width()/5-1);
+    ui->tableView_InstrumentList->setColumnWidth(0, ui->tableView_InstrumentList->width()*4/5);
+    ui->tableView_InstrumentList->setColumnWidth(1, ui->tableView_InstrumentList->width()/5-1);
 }
 
-// Connect
+// Connect (reuses warm session unless the selected instrument changed)
 int MainWindow::LXI_connect()
 {
     int timeout = ui->spinBox_SCPITimeout->value() * 1000;
     char *ip = (char *) IP.toUtf8().data();
 
+    if (lxi_device_connected && (lxi_device_ip == IP))
+        return 0;
+
+    // Close session held against previously selected instrument
+    if (lxi_device_connected)
+        LXI_disconnect();
+
     // Connect
     lxi_device = lxi_connect(ip, 0, NULL, timeout, VXI11);
     if (lxi_device == LXI_ERROR)
@@ -159,38 +201,64 @@ int MainWindow::LXI_connect()
         return -1;
     }
 
+    lxi_device_connected = true;
+    lxi_device_ip = IP;
+
     return 0;
 }
 
 // Send command
 int MainWindow::LXI_send_receive(QString *command, QString *response, int timeout)
 {
-    char response_buffer[10000] = "";
-    char command_buffer[10000] = "";
+    QByteArray command_buffer = command->toUtf8();
+    QByteArray response_buffer;
+    char chunk[SCPI_RECEIVE_CHUNK_SIZE];
     int length;
 
     if (command->size() > 0)
     {
         // Prepare SCPI command string
-        strcpy(command_buffer, command->toUtf8().constData());
-        strip_trailing_space(command_buffer);
+        strip_trailing_space(command_buffer.data());
 
-        // Send command
-        lxi_send(lxi_device, command_buffer, strlen(command_buffer), timeout);
-
-        // If command is a question then receive response
-        if (question(command_buffer))
+        // Send command (session may be stale - reconnect and retry once)
+        length = lxi_send(lxi_device, command_buffer.data(), strlen(command_buffer.data()), timeout);
+        if (length < 0)
         {
-            length = lxi_receive(lxi_device, response_buffer, 10000, timeout);
+            LXI_disconnect();
+            if (LXI_connect() != 0)
+                return -1;
+            length = lxi_send(lxi_device, command_buffer.data(), strlen(command_buffer.data()), timeout);
             if (length < 0)
             {
-                messageBox->critical(this, "Error", "Failed to receive message!");
-                lxi_disconnect(lxi_device);
+                messageBox->critical(this, "Error", "Failed to send message!");
+                LXI_disconnect();
                 return -1;
             }
+        }
+
+        // If command is a question then receive response
+        if (question(command_buffer.data()))
+        {
+            // Receive response in chunks to impose no response size limit
+            do
+            {
+                length = lxi_receive(lxi_device, chunk, SCPI_RECEIVE_CHUNK_SIZE, timeout);
+                if (length < 0)
+                {
+                    // A timeout after a full chunk means the response was an
+                    // exact multiple of the chunk size - treat as end of data
+                    if (response_buffer.size() > 0)
+                        break;
+
+                    messageBox->critical(this, "Error", "Failed to receive message!");
+                    LXI_disconnect();
+                    return -1;
+                }
+                response_buffer.append(chunk, length);
+            } while (length == SCPI_RECEIVE_CHUNK_SIZE);
 
             // Return response
-            *response = QString::fromStdString(response_buffer);
+            *response = QString::fromUtf8(response_buffer);
         }
     }
 
@@ -200,6 +268,8 @@ int MainWindow::LXI_send_receive(QString *command, QString *response, int timeou
 // Disconnect
 int MainWindow::LXI_disconnect()
 {
+    lxi_device_connected = false;
+
     if (lxi_disconnect(lxi_device) != LXI_OK)
         return -1;
     else
@@ -218,29 +288,26 @@ void MainWindow::SCPIsendCommand(QString *command)
         return;
     }
 
-    LXI_connect();
+    if (LXI_connect() != 0)
+        return;
 
-    // Print request
+    // Prepare request print
     request = "<span style=\" font-size:10pt; font-weight:600; color:#808080;\">";
     request.append(*command);
     request.append("<br></span>");
-    ui->textBrowser_SCPI_Response->insertHtml(request);
-    ui->textBrowser_SCPI_Response->ensureCursorVisible();
 
     status = LXI_send_receive(command, &response, timeout);
-    if (status == 0)
+    if ((status == 0) && (response.size() > 0))
     {
-        if (response.size() > 0)
-        {
-            // Print response
-            response.insert(0, "<span style=\" font-size:10pt; font-weight:600; color:#000000;\">");
-            response.append("<br></span>");
-            ui->textBrowser_SCPI_Response->insertHtml(response);
-            ui->textBrowser_SCPI_Response->ensureCursorVisible();
-        }
-
-        LXI_disconnect();
+        // Prepare response print
+        response.insert(0, "<span style=\" font-size:10pt; font-weight:600; color:#000000;\">");
+        response.append("<br></span>");
+        request.append(response);
     }
+
+    // Print request and response in one batch (connection stays warm)
+    ui->textBrowser_SCPI_Response->insertHtml(request);
+    ui->textBrowser_SCPI_Response->ensureCursorVisible();
 }
 
 void MainWindow::SCPIsendCommand()
@@ -267,29 +334,41 @@ void MainWindow::SCPIsendCommand(const char *command)
     SCPIsendCommand(command_);
 }
 
+// Look up column data for currently selected instrument
+QString MainWindow::InstrumentList_currentData(int column)
+{
+    QModelIndex index = ui->tableView_InstrumentList->currentIndex();
+
+    if (!index.isValid())
+        return QString();
+
+    return instrument_proxy->index(index.row(), column).data().toString();
+}
+
 void MainWindow::InstrumentList_copyID()
 {
     QClipboard *clipboard = QApplication::clipboard();
-    QTableWidgetItem *item = ui->tableWidget_InstrumentList->item(ui->tableWidget_InstrumentList->currentRow(), 0);
-    clipboard->setText(item->text());
+    clipboard->setText(InstrumentList_currentData(0));
 }
 
 void MainWindow::InstrumentList_copyIP()
 {
     QClipboard *clipboard = QApplication::clipboard();
-    QTableWidgetItem *item = ui->tableWidget_InstrumentList->item(ui->tableWidget_InstrumentList->currentRow(), 1);
-    clipboard->setText(item->text());
+    clipboard->setText(InstrumentList_currentData(1));
 }
 
 void MainWindow::InstrumentList_openBrowser()
 {
-    QTableWidgetItem *item = ui->tableWidget_InstrumentList->item(ui->tableWidget_InstrumentList->currentRow(), 1);
-    QString URL = "http://" + item->text();
+    QString URL = "http://" + InstrumentList_currentData(1);
     QDesktopServices::openUrl(QUrl(URL));
 }
 
 MainWindow::~MainWindow()
 {
+    // Close warm SCPI session
+    if (lxi_device_connected)
+        LXI_disconnect();
+
     delete ui;
 }
 
@@ -298,31 +377,41 @@ void MainWindow::on_pushButton_Search_clicked()
 {
     int timeout = ui->spinBox_SearchTimeout->value() * 1000;
 
-    ui->tableWidget_InstrumentList->clearContents();
-    ui->tableWidget_InstrumentList->setRowCount(0);
+    if (search_active)
+        return;
+    search_active = true;
+
+    instrument_model->clear();
     ui->pushButton_Search->setText("Searching");
-    ui->pushButton_Search->repaint();
-    lxi_discover_(timeout, ui->checkBox_mDNS->isChecked() ? DISCOVER_MDNS : DISCOVER_VXI11);
-    ui->statusBar->clearMessage();
-    ui->pushButton_Search->setText("Search");
+    ui->pushButton_Search->setEnabled(false);
     IP.clear();
+
+    // Run discovery in worker thread so the UI stays responsive while
+    // found instruments are added to the list incrementally
+    DiscoverThread *discoverthread = new DiscoverThread;
+    connect(discoverthread, SIGNAL(instrumentFound(QString, QString)), this, SLOT(add_instrument(QString, QString)));
+    connect(discoverthread, SIGNAL(statusUpdate(QString)), this, SLOT(update_statusbar(QString)));
+    connect(discoverthread, SIGNAL(finished()), this, SLOT(Search_Finished()));
+    connect(discoverthread, SIGNAL(finished()), discoverthread, SLOT(deleteLater()));
+    discoverthread->startDiscover(timeout, ui->checkBox_mDNS->isChecked() ? DISCOVER_MDNS : DISCOVER_VXI11);
 }
 
-void MainWindow::add_instrument(const char *id, const char *address)
+void MainWindow::Search_Finished()
 {
-    QString instrument_id = QString::fromStdString(id);
-    QString instrument_address = QString::fromStdString(address);
+    ui->statusBar->clearMessage();
+    ui->pushButton_Search->setText("Search");
+    ui->pushButton_Search->setEnabled(true);
+    search_active = false;
+}
 
-    ui->tableWidget_InstrumentList->insertRow(0);
-    ui->tableWidget_InstrumentList->setItem(0,0, new QTableWidgetItem(instrument_id));
-    ui->tableWidget_InstrumentList->setItem(0,1, new QTableWidgetItem(instrument_address));
-    ui->tableWidget_InstrumentList->item(0,1)->setTextAlignment(Qt::AlignCenter);
+void MainWindow::add_instrument(QString id, QString address)
+{
+    instrument_model->addInstrument(id, address);
 }
 
-void MainWindow::update_statusbar(const char *message)
+void MainWindow::update_statusbar(QString message)
 {
-    QString status_message = QString::fromStdString(message);
-    ui->statusBar->showMessage(status_message);
+    ui->statusBar->showMessage(message);
 }
 
 // SCPI Send button
@@ -331,12 +420,10 @@ void MainWindow::on_pushButton_SCPI_Send_clicked()
     SCPIsendCommand();
 }
 
-void MainWindow::on_tableWidget_InstrumentList_cellClicked(__attribute__((unused)) int row, __attribute__((unused)) int column)
+void MainWindow::on_tableView_InstrumentList_clicked(__attribute__((unused)) const QModelIndex &index)
 {
-    QTableWidgetItem *item = ui->tableWidget_InstrumentList->item(ui->tableWidget_InstrumentList->currentRow(), 1);
-
     // Update IP
-    IP = item->text();
+    IP = InstrumentList_currentData(1);
 }
 
 void MainWindow::update_progressbar()
@@ -347,8 +434,6 @@ void MainWindow::update_progressbar()
 // Benchmark start
 void MainWindow::on_pushButton_Benchmark_Start_clicked()
 {
-    double result;
-    QString q_result;
     QMessageBox messageBox(this);
 
     if (IP.isEmpty())
@@ -357,21 +442,51 @@ void MainWindow::on_pushButton_Benchmark_Start_clicked()
         return;
     }
 
+    if (benchmark_active)
+        return;
+    benchmark_active = true;
+
     // Reset
     ui->label_6->clear();
     ui->progressBar->setValue(0);
     ui->progressBar->setMaximum(ui->spinBox_BenchmarkRequests->value());
+    benchmark_series->clear();
 
-    // Run benchmark
+    // Run benchmark in worker thread so the UI stays responsive
     ui->pushButton_Benchmark_Start->setText("Testing");
-    ui->pushButton_Benchmark_Start->repaint();
-    benchmark(IP.toUtf8().data(), 0, 1000, VXI11, ui->spinBox_BenchmarkRequests->value(), false, &result, benchmark_progress);
-    ui->pushButton_Benchmark_Start->setText("Start");
-    ui->pushButton_Benchmark_Start->repaint();
+    ui->pushButton_Benchmark_Start->setEnabled(false);
+    BenchmarkThread *benchmarkthread = new BenchmarkThread;
+    connect(benchmarkthread, SIGNAL(progressUpdated()), this, SLOT(update_progressbar()));
+    connect(benchmarkthread, SIGNAL(benchmarkFinished(double, QVector<double>)), this, SLOT(Benchmark_Finished(double, QVector<double>)));
+    connect(benchmarkthread, SIGNAL(finished()), benchmarkthread, SLOT(deleteLater()));
+    benchmarkthread->startBenchmark(IP, ui->spinBox_BenchmarkRequests->value());
+}
+
+void MainWindow::Benchmark_Finished(double result, QVector<double> latency)
+{
+    double latency_max = 0;
+    QString q_result;
+    int i;
+
+    // Plot per request latency series
+    for (i=0; i<latency.size(); i++)
+    {
+        benchmark_series->append(i+1, latency.at(i));
+        if (latency.at(i) > latency_max)
+            latency_max = latency.at(i);
+    }
+    benchmark_axisX->setRange(1, latency.size());
+    benchmark_axisY->setRange(0, latency_max);
+    benchmark_axisY->applyNiceNumbers();
 
     // Print result
     q_result = QString::number(result, 'f', 1);
     ui->label_6->setText(q_result + " requests/second");
+
+    ui->pushButton_Benchmark_Start->setText("Start");
+    ui->pushButton_Benchmark_Start->setEnabled(true);
+
+    benchmark_active = false;
 }
 
 void MainWindow::Screenshot_UpdateUI(QPixmap pixmap, QString image_format, QString image_filename)
@@ -453,7 +568,6 @@ void MainWindow::on_pushButton_Screenshot_TakeScreenshot_clicked()
 {
     char *plugin_name = (char *) "";
     char *filename = (char *) "";
-    char image_buffer[0x200000];
     int image_size = 0;
     char image_format[10];
     char image_filename[1000];
@@ -468,6 +582,7 @@ void MainWindow::on_pushButton_Screenshot_TakeScreenshot_clicked()
     }
 
     // Capture screenshot
+    char *image_buffer = ImageBufferPool::acquire();
     screenshot(IP.toUtf8().data(), plugin_name, filename, timeout, false, image_buffer, &image_size, image_format, image_filename);
 
     screenshotImageFormat.clear();
@@ -489,6 +604,8 @@ void MainWindow::on_pushButton_Screenshot_TakeScreenshot_clicked()
 
     ui->graphicsView_Screenshot->show();
 
+    ImageBufferPool::release(image_buffer);
+
     // Enable buttons
     ui->pushButton_Screenshot_Save->setEnabled(true);
 }
@@ -638,13 +755,20 @@ void MainWindow::on_pushButton_DataRecorder_Start_clicked()
     {
         // Stop recording
         timer->stop();
+        acquisitionthread->stopAcquisition();
+
+        // Drain any samples still queued in the ring buffer
+        DataRecorder_Update();
+
+        delete acquisitionthread;
+        acquisitionthread = NULL;
+
         ui->pushButton_DataRecorder_Start->setText("Start");
-        LXI_disconnect();
 
         // Enable inputs
         ui->lineEdit->setEnabled(true);
         ui->lineEdit_2->setEnabled(true);
-        if (line_series0->count() || line_series1->count())
+        if (samples0.size() || samples1.size())
             ui->pushButton_DataRecorder_Save->setEnabled(true);
         else
             ui->pushButton_DataRecorder_Save->setEnabled(false);
@@ -653,6 +777,8 @@ void MainWindow::on_pushButton_DataRecorder_Start_clicked()
     else
     {
         // Reset
+        samples0.clear();
+        samples1.clear();
         line_series0->clear();
         line_series1->clear();
         axisX->setRange(0, 1);
@@ -660,14 +786,14 @@ void MainWindow::on_pushButton_DataRecorder_Start_clicked()
         data_recorder_first_sample = true;
         data_recorder_sample_counter = 0;
 
-        // Start recording
-        time.start();
-        data_recorder_time_slice = 1000 / ui->spinBox_DataRecorderRate->value();
-        timer->start(data_recorder_time_slice);
+        // Start acquisition thread sampling at the configured rate while
+        // the GUI timer only drains the ring buffer and updates the chart
+        acquisitionthread = new AcquisitionThread;
+        acquisitionthread->startAcquisition(IP, ui->lineEdit->text(), ui->lineEdit_2->text(),
+                                            ui->spinBox_DataRecorderRate->value(), 1000);
+        timer->start(DATA_RECORDER_UPDATE_INTERVAL);
         ui->pushButton_DataRecorder_Start->setText("Stop");
 
-        LXI_connect();
-
         // Disable inputs
         ui->lineEdit->setEnabled(false);
         ui->lineEdit_2->setEnabled(false);
@@ -682,33 +808,30 @@ void MainWindow::on_pushButton_DataRecorder_Start_clicked()
 
 void MainWindow::DataRecorder_Update()
 {
-    QString response;
+    Sample sample;
+    double sample_max = 0;
     double elapsed_time = 0;
-    double sample_max, sample0 = 0, sample1 = 0;
+    bool updated = false;
 
-    if (!ui->lineEdit->text().isEmpty())
+    // Drain all samples queued by the acquisition thread into the compact
+    // backing store - the chart series only ever holds a decimated view
+    while (acquisitionthread->buffer.pop(sample))
     {
-        // Retrieve sample 1
-        QString command = ui->lineEdit->text();
-        LXI_send_receive(&command, &response, 1000);
-        elapsed_time = ((double) time.elapsed()) / 1000;
-        sample0 = response.toDouble();
-        line_series0->append(elapsed_time, sample0);
-    }
+        if (sample.channel == 0)
+            samples0.append(QPointF(sample.time, sample.value));
+        else
+            samples1.append(QPointF(sample.time, sample.value));
 
-    if (!ui->lineEdit_2->text().isEmpty())
-    {
-        // Retrieve sample 2
-        QString command = ui->lineEdit_2->text();
-        LXI_send_receive(&command, &response, 1000);
-        elapsed_time = ((double) time.elapsed()) / 1000;
-        sample1 = response.toDouble();
-        line_series1->append(elapsed_time, sample1);
+        if (sample.value > sample_max)
+            sample_max = sample.value;
+        elapsed_time = sample.time;
+        updated = true;
     }
 
-    // Update chart
-    sample_max = sample0 < sample1 ? sample1 : sample0;
+    if (!updated)
+        return;
 
+    // Update chart
     if (data_recorder_first_sample)
     {
         axisY->setMax(sample_max);
@@ -722,31 +845,184 @@ void MainWindow::DataRecorder_Update()
     }
 
     axisX->setMax(elapsed_time);
+    DataRecorder_Render();
 
-    data_recorder_sample_counter++;
+    data_recorder_sample_counter = samples0.size();
+}
+
+// Reduce samples within the visible x range to min/max pairs per bucket at
+// roughly pixel resolution, so redraw cost is bounded by widget width
+void MainWindow::DataRecorder_Decimate(const QVector<QPointF> &samples, QLineSeries *series)
+{
+    double x_min = axisX->min();
+    double x_max = axisX->max();
+    int buckets = std::max(ui->chartView->width(), 100);
+    double bucket_width = (x_max - x_min) / buckets;
+    QVector<QPointF> points;
+    QPointF bucket_min, bucket_max;
+    int current_bucket = -1;
+    int i, bucket;
+
+    if (samples.isEmpty() || (bucket_width <= 0))
+    {
+        series->clear();
+        return;
+    }
+
+    // Render raw samples when there are fewer than two per bucket
+    if (samples.size() <= buckets * 2)
+    {
+        series->replace(samples);
+        return;
+    }
+
+    points.reserve(buckets * 2);
+
+    for (i = 0; i < samples.size(); i++)
+    {
+        const QPointF &point = samples.at(i);
+
+        if ((point.x() < x_min) || (point.x() > x_max))
+            continue;
+
+        bucket = (int)((point.x() - x_min) / bucket_width);
+        if (bucket != current_bucket)
+        {
+            // Flush previous bucket as min/max pair in x order
+            if (current_bucket != -1)
+            {
+                if (bucket_min.x() > bucket_max.x())
+                    std::swap(bucket_min, bucket_max);
+                points.append(bucket_min);
+                if (bucket_min != bucket_max)
+                    points.append(bucket_max);
+            }
+            current_bucket = bucket;
+            bucket_min = bucket_max = point;
+        }
+        else
+        {
+            if (point.y() < bucket_min.y())
+                bucket_min = point;
+            if (point.y() > bucket_max.y())
+                bucket_max = point;
+        }
+    }
+
+    // Flush last bucket
+    if (current_bucket != -1)
+    {
+        if (bucket_min.x() > bucket_max.x())
+            std::swap(bucket_min, bucket_max);
+        points.append(bucket_min);
+        if (bucket_min != bucket_max)
+            points.append(bucket_max);
+    }
+
+    series->replace(points);
+}
+
+void MainWindow::DataRecorder_Render()
+{
+    DataRecorder_Decimate(samples0, line_series0);
+    DataRecorder_Decimate(samples1, line_series1);
+}
+
+// Export block size - samples are formatted into a memory block which is
+// flushed to disk in large writes instead of one write per point
+#define EXPORT_BLOCK_SIZE 0x100000 // 1 MB
+
+void MainWindow::DataRecorder_ExportCSV(QFile &file)
+{
+    QByteArray block;
+    char line[100];
+    int i, length;
+    int count = qMax(samples0.size(), samples1.size());
+
+    block.reserve(EXPORT_BLOCK_SIZE + sizeof(line));
+
+    // Row layout is time,value0,value1 with an empty field when a channel
+    // has no sample at that index
+    for (i=0; i<count; i++)
+    {
+        double time = (i < samples0.size()) ? samples0.at(i).x() : samples1.at(i).x();
+
+        length = snprintf(line, sizeof(line), "%.9g,", time);
+        block.append(line, length);
+
+        if (i < samples0.size())
+        {
+            length = snprintf(line, sizeof(line), "%.9g", samples0.at(i).y());
+            block.append(line, length);
+        }
+
+        block.append(',');
+
+        if (i < samples1.size())
+        {
+            length = snprintf(line, sizeof(line), "%.9g", samples1.at(i).y());
+            block.append(line, length);
+        }
+
+        block.append('\n');
+
+        if (block.size() >= EXPORT_BLOCK_SIZE)
+        {
+            file.write(block);
+            block.clear();
+        }
+    }
+
+    file.write(block);
+}
+
+void MainWindow::DataRecorder_ExportBinary(QFile &file)
+{
+    QByteArray block;
+    double record[3];
+    int i;
+    int count = qMax(samples0.size(), samples1.size());
+
+    block.reserve(EXPORT_BLOCK_SIZE + sizeof(record));
+
+    // Fixed-width records of three float64 fields (time, value0, value1),
+    // with NaN for a channel that has no sample at that index
+    for (i=0; i<count; i++)
+    {
+        record[0] = (i < samples0.size()) ? samples0.at(i).x() : samples1.at(i).x();
+        record[1] = (i < samples0.size()) ? samples0.at(i).y() : qQNaN();
+        record[2] = (i < samples1.size()) ? samples1.at(i).y() : qQNaN();
+
+        block.append((const char *) record, sizeof(record));
+
+        if (block.size() >= EXPORT_BLOCK_SIZE)
+        {
+            file.write(block);
+            block.clear();
+        }
+    }
+
+    file.write(block);
 }
 
 // Data recorder save
 void MainWindow::on_pushButton_DataRecorder_Save_clicked()
 {
-    int i;
+    QString selected_filter;
+
+    QString filename = QFileDialog::getSaveFileName(this, "Save file", "data.csv",
+                           "Text CSV (*.csv);;Binary float64 (*.bin)", &selected_filter);
+    if (filename.isEmpty())
+        return;
 
-    QString filename = QFileDialog::getSaveFileName(this, "Save file", "data.csv", "Text CSV (.csv)");
     QFile file(filename);
     file.open(QIODevice::WriteOnly|QFile::Truncate);
-    QTextStream stream(&file);
-    for (i=0;i<data_recorder_sample_counter; i++)
-    {
-        stream << line_series0->at(i).x();
-
-        if (line_series0->count())
-            stream << "," << line_series0->at(i).y();
 
-        if (line_series1->count())
-            stream << "," << line_series1->at(i).y();
+    if (selected_filter.contains("Binary"))
+        DataRecorder_ExportBinary(file);
+    else
+        DataRecorder_ExportCSV(file);
 
-        stream << "\n";
-    }
     file.close();
 }
 
@@ -11,6 +11,15 @@
 #include <QTimer>
 #include <QTime>
 #include <QThread>
+#include <QVector>
+#include <QFile>
+#include <QSortFilterProxyModel>
+#include "acquisitionthread.h"
+#include "instrumentlistmodel.h"
+
+// GUI chart update interval in milliseconds (decoupled from sample rate)
+#define DATA_RECORDER_UPDATE_INTERVAL 50
+#define SCPI_RECEIVE_CHUNK_SIZE 0x10000
 
 QT_CHARTS_USE_NAMESPACE
 
@@ -25,15 +34,12 @@ class MainWindow : public QMainWindow
 public:
     explicit MainWindow(QWidget *parent = 0);
     ~MainWindow();
-    void add_instrument(const char *id, const char *address);
-    void update_statusbar(const char *message);
-    void update_progressbar();
     void pushButton_reset();
     void resizeEvent(QResizeEvent *event);
     void resize();
 
 private slots:
-    void on_tableWidget_InstrumentList_cellClicked(int row, int column);
+    void on_tableView_InstrumentList_clicked(const QModelIndex &index);
     void InstrumentList_copyID();
     void InstrumentList_copyIP();
     void InstrumentList_openBrowser();
@@ -44,8 +50,14 @@ private slots:
     void DataRecorder_zoomIn();
     void DataRecorder_zoomReset();
     void DataRecorder_Update();
+    void DataRecorder_Render();
     void on_pushButton_Search_clicked();
+    void Search_Finished();
+    void add_instrument(QString id, QString address);
+    void update_statusbar(QString message);
     void on_pushButton_Benchmark_Start_clicked();
+    void Benchmark_Finished(double result, QVector<double> latency);
+    void update_progressbar();
     void on_pushButton_Screenshot_TakeScreenshot_clicked();
     void on_pushButton_Screenshot_Save_clicked();
     void on_pushButton_Screenshot_LiveView_clicked();
@@ -78,6 +90,10 @@ private slots:
     void on_pushButton_SCPI_StatusPreset_clicked();
 
 private:
+    QString InstrumentList_currentData(int column);
+    void DataRecorder_Decimate(const QVector<QPointF> &samples, QLineSeries *series);
+    void DataRecorder_ExportCSV(QFile &file);
+    void DataRecorder_ExportBinary(QFile &file);
     Ui::MainWindow *ui;
     QMessageBox *messageBox;
     QLineEdit *lineEdit;
@@ -87,14 +103,25 @@ private:
     QString screenshotImageFilename;
     QLineSeries *line_series0;
     QLineSeries *line_series1;
+    QVector<QPointF> samples0;
+    QVector<QPointF> samples1;
     QChart *datarecorder_chart;
+    QChart *benchmark_chart;
+    QLineSeries *benchmark_series;
+    QValueAxis *benchmark_axisX;
+    QValueAxis *benchmark_axisY;
+    InstrumentListModel *instrument_model;
+    QSortFilterProxyModel *instrument_proxy;
     int lxi_device;
+    bool lxi_device_connected = false;
+    QString lxi_device_ip;
     QTimer *timer;
-    QTime time;
+    AcquisitionThread *acquisitionthread = NULL;
     bool live_view_active;
+    bool search_active = false;
+    bool benchmark_active = false;
     bool data_recorder_active;
     int data_recorder_sample_counter;
-    double data_recorder_time_slice;
     bool data_recorder_first_sample = true;
     QGraphicsScene* scene;
     QGraphicsPixmapItem* pixmapItem = NULL;
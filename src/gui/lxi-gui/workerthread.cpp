@@ -1,30 +1,124 @@
 #include "mainwindow.h"
 #include "workerthread.h"
+#include "imagebufferpool.h"
 #include <QString>
 #include <QPixmap>
+#include <QMutexLocker>
 #include <iostream>
+#include <cstring>
 #include "../../include/screenshot.h"
 
+// Fast non-cryptographic content hash (FNV-1a processing 8 bytes per round)
+// used to detect frames identical to the previous one
+static quint64 frame_hash(const char *data, int length)
+{
+    const quint64 prime = 0x100000001b3ULL;
+    quint64 hash = 0xcbf29ce484222325ULL;
+    quint64 word;
+    int i = 0;
+
+    for (; i + 8 <= length; i += 8)
+    {
+        memcpy(&word, data + i, 8);
+        hash = (hash ^ word) * prime;
+    }
+
+    for (; i < length; i++)
+        hash = (hash ^ (unsigned char) data[i]) * prime;
+
+    return hash;
+}
+
+void WorkerThread::pushFrame(const Frame &frame)
+{
+    QMutexLocker locker(&queue_mutex);
+
+    while ((frame_queue.size() >= FRAME_QUEUE_DEPTH) && live)
+        queue_not_full.wait(&queue_mutex);
+
+    frame_queue.enqueue(frame);
+    queue_not_empty.wakeOne();
+}
+
+bool WorkerThread::popFrame(Frame &frame)
+{
+    QMutexLocker locker(&queue_mutex);
+
+    while (frame_queue.isEmpty() && live)
+        queue_not_empty.wait(&queue_mutex);
+
+    if (frame_queue.isEmpty())
+        return false;
+
+    frame = frame_queue.dequeue();
+    queue_not_full.wakeOne();
+    return true;
+}
+
+void WorkerThread::emitUpdate(QPixmap pixmap, QString format, QString filename)
+{
+    emit requestUpdateUI(pixmap, format, filename);
+}
+
+void DecodeThread::run()
+{
+    Frame frame;
+    QPixmap pixmap;
+
+    while (capture->popFrame(frame))
+    {
+        // Decode frame N while the capture stage receives frame N+1
+        pixmap.loadFromData((const uchar*) frame.buffer, frame.size, "", Qt::AutoColor);
+        ImageBufferPool::release(frame.buffer);
+
+        capture->emitUpdate(pixmap, frame.format, frame.filename);
+    }
+}
+
 void WorkerThread::run()
 {
     char *plugin_name = (char *) "";
     char *filename = (char *) "";
-    char image_buffer[0x200000];
+    char *image_buffer;
     int image_size = 0;
     char image_format[10];
     char image_filename[1000];
-    QPixmap pixmap;
+    quint64 hash, previous_hash = 0;
+    Frame frame;
+
+    // Start decode stage
+    DecodeThread decoder(this);
+    decoder.start();
 
     while (live)
     {
-        // Capture screenshot
-        // TODO: Optmize so we avoid plugin autodetect overhead at every capture
+        image_buffer = ImageBufferPool::acquire();
+
+        // Capture screenshot (plugin autodetect result is cached per address)
         screenshot(IP.toUtf8().data(), plugin_name, filename, timeout, false, image_buffer, &image_size, image_format, image_filename);
 
-        pixmap.loadFromData((const uchar*) image_buffer, image_size, "", Qt::AutoColor);
+        // Skip decode and repaint when the frame content is unchanged
+        hash = frame_hash(image_buffer, image_size);
+        if (hash == previous_hash)
+        {
+            ImageBufferPool::release(image_buffer);
+            continue;
+        }
+        previous_hash = hash;
 
-        emit requestUpdateUI(pixmap, QString(image_format), QString(image_filename));
+        // Hand frame to decode stage
+        frame.buffer = image_buffer;
+        frame.size = image_size;
+        frame.format = QString(image_format);
+        frame.filename = QString(image_filename);
+        pushFrame(frame);
     }
+
+    // Wake decode stage so it can drain remaining frames and exit
+    queue_mutex.lock();
+    queue_not_empty.wakeAll();
+    queue_mutex.unlock();
+    decoder.wait();
 }
 
 void WorkerThread::startLiveUpdate(const QString IP, int timeout)
@@ -5,6 +5,21 @@
 #include <QThread>
 #include <QString>
 #include <QPixmap>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+
+// Captured frame handed from the capture stage to the decode stage
+struct Frame
+{
+    char *buffer;
+    int size;
+    QString format;
+    QString filename;
+};
+
+// Frames in flight between capture and decode (double buffering)
+#define FRAME_QUEUE_DEPTH 2
 
 class WorkerThread : public QThread
 {
@@ -15,12 +30,36 @@ public:
     void startLiveUpdate(const QString IP, int timeout);
     bool live = true;
 
+    // Used by the decode stage
+    bool popFrame(Frame &frame);
+    void emitUpdate(QPixmap pixmap, QString format, QString filename);
+
 private:
+    void pushFrame(const Frame &frame);
+
     QString IP;
     int timeout;
 
+    QMutex queue_mutex;
+    QWaitCondition queue_not_empty;
+    QWaitCondition queue_not_full;
+    QQueue<Frame> frame_queue;
+
 signals:
     void requestUpdateUI(QPixmap pixmap, QString format, QString filename);
 };
 
+// Decode stage - decodes frame N while the capture stage receives frame N+1
+class DecodeThread : public QThread
+{
+    Q_OBJECT
+
+public:
+    DecodeThread(WorkerThread *capture) : capture(capture) {}
+    void run() override;
+
+private:
+    WorkerThread *capture;
+};
+
 #endif // WORKERTHREAD_H
@@ -47,7 +47,9 @@ extern "C" {
 #include "error.h"
 #include <lxi.h>
 
-int benchmark(char *ip, int port, int timeout, lxi_protocol_t protocol, int count, bool no_gui, double *result, void (*progress)(void));
+int benchmark(char *ip, int port, int timeout, lxi_protocol_t protocol, int count, bool no_gui, double *result, void (*progress)(void), double *latency);
+int benchmark_concurrent(char *ip, int port, int timeout, lxi_protocol_t protocol, int count, int connections);
+int benchmark_sweep(char *ip, int port, int timeout, int count, char *query);
 
 #ifdef __cplusplus
 }
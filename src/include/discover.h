@@ -34,5 +34,10 @@
 #include <stdbool.h>
 
 int discover(bool mdns, int timeout);
+int discover_subnet(const char *subnet, int timeout);
+
+// Discovery cache mapping instrument IDs to addresses
+void discover_cache_add(const char *address, const char *id);
+int discover_cache_lookup(const char *name, char *address, int length);
 
 #endif
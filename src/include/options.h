@@ -44,8 +44,11 @@ struct option_t
     char scpi_command[500];
     bool hex;
     bool interactive;
+    bool batch;
     bool run_script;
     char *script_filename;
+    char *output_filename;
+    char *input_filename;
     char lua_script_filename[1000];
     char *plugin_name;
     bool list;
@@ -53,7 +56,11 @@ struct option_t
     lxi_protocol_t protocol;
     int port;
     bool mdns;
+    char *subnet;
     int count;
+    int connections;
+    char *sweep_query;
+    int delay;
 };
 
 enum command_t
@@ -63,6 +70,8 @@ enum command_t
     SCREENSHOT,
     BENCHMARK,
     RUN,
+    DAEMON,
+    EMULATOR,
     NO_COMMAND
 };
 
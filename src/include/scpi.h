@@ -48,7 +48,9 @@ extern "C" {
 #include <lxi.h>
 
 int scpi(char *ip, int port, int timeout, lxi_protocol_t protocol, char *command);
+int scpi_fanout(char *ip_list, int port, int timeout, lxi_protocol_t protocol, char *command);
 int enter_interactive_mode(char *ip, int port, int timeout, lxi_protocol_t protocol);
+int enter_batch_mode(char *ip, int port, int timeout, lxi_protocol_t protocol);
 int run_script(char *ip, int port, int timeout, lxi_protocol_t protocol, char *filename);
 
 void strip_trailing_space(char *line);
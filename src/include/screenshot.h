@@ -45,12 +45,25 @@ int screenshot(char *address, char *plugin_name, char *filename,
 // Screenshot helper function used by plugins to dump image file
 void screenshot_file_dump(void *data, int length, char *format);
 
+// Streaming dump sink - open the destination (file, stdout or GUI image
+// buffer) up front and append image data chunks as they arrive
+void screenshot_dump_open(char *format);
+void screenshot_dump_write(void *data, int length);
+void screenshot_dump_close(void);
+
+// Screenshot helpers used by plugins to receive and dump image data.
+// screenshot_tmc_dump() parses a TMC/IEEE 488.2 definite length block
+// header (#N<len>) and receives exactly <len> payload bytes incrementally,
+// screenshot_raw_dump() receives headerless image data.
+int screenshot_tmc_dump(int device, int timeout, char *format);
+int screenshot_raw_dump(int device, int timeout, char *format);
+
 struct screenshot_plugin
 {
    const char *name;
    const char *description;
    const char *regex;
-   int (*screenshot)(char *address, int timeout);
+   int (*screenshot)(int device, int timeout);
 };
 
 #ifdef __cplusplus
@@ -29,15 +29,20 @@
  */
 
 #include <unistd.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
 #include <lua.h>
 #include <lauxlib.h>
 #include <lualib.h>
 #include <string.h>
 #include <lxi.h>
+#include "profile.h"
 #include "options.h"
 #include "error.h"
 
-#define RESPONSE_LENGTH_MAX 0x400000
+#define RESPONSE_CHUNK_SIZE 0x10000
+#define ASYNC_REQUESTS_MAX 32
 
 extern int question(const char *string);
 
@@ -71,11 +76,101 @@ static int disconnect(lua_State *L)
     return 1;
 }
 
+// Reusable per-state receive buffer kept in the Lua registry so the hot
+// path performs no large allocations and small responses never touch a
+// multi-megabyte buffer
+struct receive_buffer_t
+{
+    char *data;
+    int size;
+};
+
+static int receive_buffer_gc(lua_State *L)
+{
+    struct receive_buffer_t *buffer = lua_touserdata(L, 1);
+
+    free(buffer->data);
+
+    return 0;
+}
+
+static struct receive_buffer_t *receive_buffer(lua_State *L)
+{
+    struct receive_buffer_t *buffer;
+
+    lua_pushstring(L, "lxi.receive_buffer");
+    lua_rawget(L, LUA_REGISTRYINDEX);
+
+    if (!lua_isnil(L, -1))
+    {
+        buffer = lua_touserdata(L, -1);
+        lua_pop(L, 1);
+        return buffer;
+    }
+    lua_pop(L, 1);
+
+    // Create buffer on first use
+    buffer = lua_newuserdata(L, sizeof(struct receive_buffer_t));
+    buffer->size = RESPONSE_CHUNK_SIZE;
+    buffer->data = malloc(buffer->size);
+
+    // Attach metatable with finalizer
+    lua_createtable(L, 0, 1);
+    lua_pushstring(L, "__gc");
+    lua_pushcfunction(L, receive_buffer_gc);
+    lua_rawset(L, -3);
+    lua_setmetatable(L, -2);
+
+    lua_pushstring(L, "lxi.receive_buffer");
+    lua_pushvalue(L, -2);
+    lua_rawset(L, LUA_REGISTRYINDEX);
+    lua_pop(L, 1);
+
+    return buffer;
+}
+
+// Receive response into reusable buffer, growing it geometrically
+static int receive_response(lua_State *L, int device, struct receive_buffer_t *buffer)
+{
+    int length, received = 0;
+
+    if (buffer->data == NULL)
+        return -1;
+
+    do
+    {
+        if (received == buffer->size)
+        {
+            char *data = realloc(buffer->data, buffer->size * 2);
+            if (data == NULL)
+                return -1;
+            buffer->data = data;
+            buffer->size *= 2;
+        }
+
+        length = lxi_receive(device, buffer->data + received, buffer->size - received, option.timeout);
+        if (length < 0)
+        {
+            // A timeout after a buffer-filling read means the response
+            // was an exact multiple of the read size - end of data
+            if (received > 0)
+                break;
+
+            return length;
+        }
+
+        received += length;
+
+    } while (received == buffer->size);
+
+    return received;
+}
+
 // lua: scpi(device, command)
 static int scpi(lua_State *L)
 {
-    char response[RESPONSE_LENGTH_MAX];
-    int status = 0, length;
+    struct receive_buffer_t *buffer = receive_buffer(L);
+    int status = 0, length = 0;
     int device = lua_tointeger(L, 1);
     const char *command = lua_tostring(L, 2);
 
@@ -87,31 +182,29 @@ static int scpi(lua_State *L)
         status = length;
         goto error;
     }
+    length = 0;
 
     // Only expect response in case we are firing a question command
     if (question(command))
     {
-        length = lxi_receive(device, response, RESPONSE_LENGTH_MAX, option.timeout);
+        length = receive_response(L, device, buffer);
         if (length < 0)
         {
             error_printf("Failed to receive message\n");
             status = length;
             goto error;
         }
-    }
 
-    if (length > 0)
-    {
         // Strip newline
-        if (response[length-1] == '\n')
-            response[--length] = 0;
+        if ((length > 0) && (buffer->data[length-1] == '\n'))
+            length--;
 
         // Strip carriage return
-        if (response[length-1] == '\r')
-            response[--length] = 0;
+        if ((length > 0) && (buffer->data[length-1] == '\r'))
+            length--;
     }
 
-    lua_pushlstring(L, response, length);
+    lua_pushlstring(L, buffer->data, length);
     return 1;
 
 error:
@@ -123,8 +216,8 @@ error:
 // lua: scpi_raw(device, command)
 static int scpi_raw(lua_State *L)
 {
-    char response[RESPONSE_LENGTH_MAX];
-    int status = 0, length;
+    struct receive_buffer_t *buffer = receive_buffer(L);
+    int status = 0, length = 0;
     int device = lua_tointeger(L, 1);
     const char *command = lua_tostring(L, 2);
 
@@ -136,11 +229,12 @@ static int scpi_raw(lua_State *L)
         status = length;
         goto error;
     }
+    length = 0;
 
     // Only expect response in case we are firing a question command
     if (question(command))
     {
-        length = lxi_receive(device, response, RESPONSE_LENGTH_MAX, option.timeout);
+        length = receive_response(L, device, buffer);
         if (length < 0)
         {
             error_printf("Failed to receive message\n");
@@ -149,7 +243,7 @@ static int scpi_raw(lua_State *L)
         }
     }
 
-    lua_pushlstring(L, response, length);
+    lua_pushlstring(L, buffer->data, length);
     return 1;
 
 error:
@@ -159,6 +253,280 @@ error:
 }
 
 
+// lua: bytes = scpi_to_file(device, command, filename)
+static int scpi_to_file(lua_State *L)
+{
+    char chunk[RESPONSE_CHUNK_SIZE];
+    int device = lua_tointeger(L, 1);
+    const char *command = lua_tostring(L, 2);
+    const char *filename = lua_tostring(L, 3);
+    long payload_length = -1, received = 0;
+    int length, offset = 0;
+    FILE *fd;
+
+    // Send SCPI command
+    length = lxi_send(device, command, strlen(command), option.timeout);
+    if (length < 0)
+    {
+        error_printf("Failed to send message\n");
+        goto error;
+    }
+
+    fd = fopen(filename, "w");
+    if (fd == NULL)
+    {
+        error_printf("Unable to open file %s\n", filename);
+        goto error;
+    }
+
+    // Receive first chunk which holds any definite length block header
+    length = lxi_receive(device, chunk, RESPONSE_CHUNK_SIZE, option.timeout);
+    if (length < 0)
+    {
+        error_printf("Failed to receive message\n");
+        goto error_receive;
+    }
+
+    // Parse IEEE 488.2 definite length block header (#N<len>)
+    if ((length > 2) && (chunk[0] == '#') && (chunk[1] >= '1') && (chunk[1] <= '9'))
+    {
+        char length_field[10+1] = "";
+        int digits = chunk[1] - '0';
+
+        if (length > (2 + digits))
+        {
+            memcpy(length_field, &chunk[2], digits);
+            payload_length = atol(length_field);
+            offset = 2 + digits;
+        }
+    }
+
+    // Stream payload chunks directly to file so the Lua heap stays flat
+    while (true)
+    {
+        int write_length = length - offset;
+
+        // Do not write past end of payload (strips trailing newline)
+        if ((payload_length >= 0) && ((received + write_length) > payload_length))
+            write_length = payload_length - received;
+
+        if (write_length > 0)
+        {
+            if (fwrite(&chunk[offset], 1, write_length, fd) != (size_t) write_length)
+            {
+                error_printf("Failed to write to file %s\n", filename);
+                goto error_receive;
+            }
+            received += write_length;
+        }
+        offset = 0;
+
+        // Stop when full payload is received or on short read
+        if ((payload_length >= 0) && (received >= payload_length))
+            break;
+        if (length < RESPONSE_CHUNK_SIZE)
+            break;
+
+        length = lxi_receive(device, chunk, RESPONSE_CHUNK_SIZE, option.timeout);
+        if (length < 0)
+        {
+            // A timeout after a full chunk means the response was an
+            // exact multiple of the chunk size - treat as end of data
+            if (received > 0)
+                break;
+
+            error_printf("Failed to receive message\n");
+            goto error_receive;
+        }
+    }
+
+    fclose(fd);
+
+    // Return number of payload bytes written
+    lua_pushinteger(L, received);
+    return 1;
+
+error_receive:
+    fclose(fd);
+error:
+    // Return status
+    lua_pushnumber(L, -1);
+    return 1;
+}
+
+// Outstanding asynchronous request driven by a worker thread
+struct async_request_t
+{
+    pthread_t thread;
+    int device;
+    int timeout;
+    char command[1000];
+    char *response;
+    int length;
+    int status;
+    bool active;
+};
+
+static struct async_request_t async_request[ASYNC_REQUESTS_MAX];
+
+static void *async_worker(void *data)
+{
+    struct async_request_t *request = data;
+    int length, received = 0, size = RESPONSE_CHUNK_SIZE;
+
+    request->status = -1;
+
+    // Send SCPI command
+    length = lxi_send(request->device, request->command, strlen(request->command), request->timeout);
+    if (length < 0)
+        return NULL;
+
+    // Only expect response in case we are firing a question command
+    if (question(request->command))
+    {
+        request->response = malloc(size);
+        if (request->response == NULL)
+            return NULL;
+
+        // Receive response in chunks, growing buffer as needed
+        do
+        {
+            if (received == size)
+            {
+                size *= 2;
+                request->response = realloc(request->response, size);
+                if (request->response == NULL)
+                    return NULL;
+            }
+
+            length = lxi_receive(request->device, request->response + received, size - received, request->timeout);
+            if (length < 0)
+            {
+                // A timeout after a buffer-filling read means the response
+                // was an exact multiple of the read size - end of data
+                if (received > 0)
+                    break;
+
+                return NULL;
+            }
+
+            received += length;
+
+        } while (received == size);
+
+        request->length = received;
+    }
+
+    request->status = 0;
+
+    return NULL;
+}
+
+// Push completed request result and release its slot
+static int async_request_finish(lua_State *L, struct async_request_t *request)
+{
+    pthread_join(request->thread, NULL);
+
+    if (request->status != 0)
+    {
+        error_printf("Failed to communicate with LXI device\n");
+        lua_pushnumber(L, request->status);
+    }
+    else if (request->response != NULL)
+    {
+        int length = request->length;
+
+        // Strip newline
+        if ((length > 0) && (request->response[length-1] == '\n'))
+            length--;
+
+        // Strip carriage return
+        if ((length > 0) && (request->response[length-1] == '\r'))
+            length--;
+
+        lua_pushlstring(L, request->response, length);
+    }
+    else
+        lua_pushlstring(L, "", 0);
+
+    free(request->response);
+    request->response = NULL;
+    request->active = false;
+
+    return 1;
+}
+
+// lua: handle = scpi_async(device, command)
+static int scpi_async(lua_State *L)
+{
+    int device = lua_tointeger(L, 1);
+    const char *command = lua_tostring(L, 2);
+    int i;
+
+    // Find free request slot
+    for (i = 0; i < ASYNC_REQUESTS_MAX; i++)
+    {
+        if (!async_request[i].active)
+            break;
+    }
+
+    if (i == ASYNC_REQUESTS_MAX)
+    {
+        error_printf("Too many outstanding async requests\n");
+        lua_pushinteger(L, -1);
+        return 1;
+    }
+
+    async_request[i].device = device;
+    async_request[i].timeout = option.timeout;
+    strncpy(async_request[i].command, command, sizeof(async_request[i].command) - 1);
+    async_request[i].response = NULL;
+    async_request[i].length = 0;
+    async_request[i].active = true;
+
+    // Fire request worker
+    pthread_create(&async_request[i].thread, NULL, async_worker, &async_request[i]);
+
+    // Return request handle
+    lua_pushinteger(L, i + 1);
+    return 1;
+}
+
+// lua: response = scpi_wait(handle)
+static int scpi_wait(lua_State *L)
+{
+    int handle = lua_tointeger(L, 1);
+
+    if ((handle < 1) || (handle > ASYNC_REQUESTS_MAX) || !async_request[handle-1].active)
+    {
+        error_printf("Invalid async request handle\n");
+        lua_pushnumber(L, -1);
+        return 1;
+    }
+
+    return async_request_finish(L, &async_request[handle-1]);
+}
+
+// lua: responses = wait_all()
+static int wait_all(lua_State *L)
+{
+    int i;
+
+    // Harvest all outstanding requests into table keyed by handle
+    lua_newtable(L);
+
+    for (i = 0; i < ASYNC_REQUESTS_MAX; i++)
+    {
+        if (!async_request[i].active)
+            continue;
+
+        async_request_finish(L, &async_request[i]);
+        lua_rawseti(L, -2, i + 1);
+    }
+
+    return 1;
+}
+
 // lua: sleep(seconds)
 static int sleep_(lua_State *L)
 {
@@ -186,6 +554,10 @@ int luaopen_lxilua(lua_State *L)
     lua_register(L, "disconnect", disconnect);
     lua_register(L, "scpi", scpi);
     lua_register(L, "scpi_raw", scpi_raw);
+    lua_register(L, "scpi_to_file", scpi_to_file);
+    lua_register(L, "scpi_async", scpi_async);
+    lua_register(L, "scpi_wait", scpi_wait);
+    lua_register(L, "wait_all", wait_all);
     lua_register(L, "sleep", sleep_);
     lua_register(L, "msleep", msleep);
     return 0;
@@ -44,6 +44,8 @@
 #include "screenshot.h"
 #include "benchmark.h"
 #include "run.h"
+#include "daemon.h"
+#include "emulator.h"
 #include <lxi.h>
 
 int main(int argc, char* argv[])
@@ -60,16 +62,22 @@ int main(int argc, char* argv[])
     switch (option.command)
     {
         case DISCOVER:
-            if (option.mdns)
+            if (strlen(option.subnet) > 0)
+                status = discover_subnet(option.subnet, option.timeout);
+            else if (option.mdns)
                 status = discover(true, option.timeout);
             else
                 status = discover(false, option.timeout);
             break;
         case SCPI:
-            if (option.interactive)
+            if (option.batch || (option.interactive && !isatty(fileno(stdin))))
+                status = enter_batch_mode(option.ip, option.port, option.timeout, option.protocol);
+            else if (option.interactive)
                 status = enter_interactive_mode(option.ip, option.port, option.timeout, option.protocol);
             else if (option.run_script)
                 status = run_script(option.ip, option.port, option.timeout, option.protocol, option.script_filename);
+            else if (strchr(option.ip, ','))
+                status = scpi_fanout(option.ip, option.port, option.timeout, option.protocol, option.scpi_command);
             else
                 status = scpi(option.ip, option.port, option.timeout, option.protocol, option.scpi_command);
             break;
@@ -83,11 +91,22 @@ int main(int argc, char* argv[])
             status = screenshot(option.ip, option.plugin_name, option.screenshot_filename, option.timeout, true, NULL, NULL, NULL, NULL);
             break;
         case BENCHMARK:
-            status = benchmark(option.ip, option.port, option.timeout, option.protocol, option.count, true, &result, NULL);
+            if (strlen(option.sweep_query) > 0)
+                status = benchmark_sweep(option.ip, option.port, option.timeout, option.count, option.sweep_query);
+            else if (option.connections > 1)
+                status = benchmark_concurrent(option.ip, option.port, option.timeout, option.protocol, option.count, option.connections);
+            else
+                status = benchmark(option.ip, option.port, option.timeout, option.protocol, option.count, true, &result, NULL, NULL);
             break;
          case RUN:
             status = run(option.lua_script_filename, option.timeout);
             break;
+        case DAEMON:
+            status = daemon_start(option.timeout);
+            break;
+        case EMULATOR:
+            status = emulator_start(option.port, option.delay);
+            break;
    }
 
     return status;
@@ -38,6 +38,8 @@
 #include <termios.h>
 #include "config.h"
 #include "options.h"
+#include "profile.h"
+#include "discover.h"
 #include "error.h"
 #include <lxi.h>
 
@@ -58,8 +60,11 @@ struct option_t option =
     "",         // Default SCPI command
     false,      // Default no hexadecimal print
     false,      // Default no interactive mode
+    false,      // Default no batch mode
     false,      // Default no run script
     "",         // Default script filename
+    "",         // Default output filename
+    "",         // Default input filename
     "",         // Default lua script filename
     "",         // Default screenshot plugin name
     false,      // Default no list
@@ -67,12 +72,16 @@ struct option_t option =
     VXI11,      // Default protocol
     0,          // Default port (set later)
     false,      // Default no mDNS discover
+    "",         // Default no subnet scan
     100,        // Default number of requests in benchmark
+    1,          // Default number of benchmark connections
+    "",         // Default no payload sweep query
+    0,          // Default no emulator response delay
 };
 
 void print_help(char *argv[])
 {
-    printf("Usage: %s [--version] [--help] <command> [<args>]\n", argv[0]);
+    printf("Usage: %s [--version] [--help] [--profile] <command> [<args>]\n", argv[0]);
     printf("\n");
     printf("  -v, --version                        Display version\n");
     printf("  -h, --help                           Display help\n");
@@ -83,19 +92,25 @@ void print_help(char *argv[])
     printf("  screenshot [<options>] [<filename>]  Capture screenshot\n");
     printf("  benchmark [<options>]                Benchmark\n");
     printf("  run [<options>] <filename>           Run Lua script\n");
+    printf("  daemon                               Hold LXI sessions open for fast scpi commands\n");
+    printf("  emulator [<options>]                 Emulate raw/TCP SCPI instrument\n");
     printf("\n");
     printf("Discover options:\n");
     printf("  -t, --timeout <seconds>              Timeout (default: Normal: %d, mDNS: %d)\n", TIMEOUT_DISCOVER, TIMEOUT_DISCOVER_MDNS);
     printf("  -m, --mdns                           Search via mDNS/DNS-SD\n");
+    printf("  -s, --subnet <a.b.c.d/prefix>        Scan subnet range via parallel connects\n");
     printf("\n");
     printf("Scpi options:\n");
-    printf("  -a, --address <ip>                   Device IP address\n");
+    printf("  -a, --address <ip>                   Device IP address (accepts comma separated list)\n");
     printf("  -p, --port <port>                    Use port (default: VXI11: %d, RAW: %d)\n", PORT_VXI11, PORT_RAW);
     printf("  -t, --timeout <seconds>              Timeout (default: %d)\n", option.timeout);
     printf("  -x, --hex                            Print response in hexadecimal\n");
     printf("  -i, --interactive                    Enter interactive mode\n");
+    printf("  -b, --batch                          Read commands from stdin (no readline)\n");
     printf("  -s, --script <filename>              Run script file\n");
     printf("  -r, --raw                            Use raw/TCP\n");
+    printf("  -o, --output <filename>              Stream binary block response to file\n");
+    printf("  -f, --input <filename>               Send file contents as command payload\n");
     printf("\n");
     printf("Screenshot options:\n");
     printf("  -a, --address <ip>                   Device IP address\n");
@@ -108,11 +123,17 @@ void print_help(char *argv[])
     printf("  -p, --port <port>                    Use port (default: VXI11: %d, RAW: %d)\n", PORT_VXI11, PORT_RAW);
     printf("  -t, --timeout <seconds>              Timeout (default: %d)\n", option.timeout);
     printf("  -c, --count <count>                  Number of requests (default: %d)\n", option.count);
+    printf("  -n, --connections <count>            Number of concurrent connections (default: %d)\n", option.connections);
+    printf("  -s, --sweep <query>                  Sweep payload sizes using query (%%d = size placeholder)\n");
     printf("  -r, --raw                            Use raw/TCP\n");
     printf("\n");
     printf("Run options:\n");
     printf("  -t, --timeout <seconds>              Timeout (default: %d)\n", option.timeout);
     printf("\n");
+    printf("Emulator options:\n");
+    printf("  -p, --port <port>                    Listen on port (default: %d)\n", PORT_RAW);
+    printf("  -d, --delay <ms>                     Response delay in milliseconds\n");
+    printf("\n");
 }
 
 void print_version(void)
@@ -122,7 +143,7 @@ void print_version(void)
 
 void parse_options(int argc, char *argv[])
 {
-    int c;
+    int c, i, j;
 
     // Print help if no arguments provided
     if (argc == 1)
@@ -131,6 +152,28 @@ void parse_options(int argc, char *argv[])
         exit(EXIT_SUCCESS);
     }
 
+    // Pre-scan for global --profile option (valid for any command)
+    for (i=1; i<argc; i++)
+    {
+        if (strcmp(argv[i], "--profile") == 0)
+        {
+            profile_enable();
+
+            // Remove from argument list
+            for (j=i; j<argc-1; j++)
+                argv[j] = argv[j+1];
+            argc--;
+            i--;
+        }
+    }
+
+    // Print help if only global options provided
+    if (argc == 1)
+    {
+        print_help(argv);
+        exit(EXIT_SUCCESS);
+    }
+
     // Convert default timeout to milliseconds
     option.timeout = option.timeout * 1000;
 
@@ -148,13 +191,14 @@ void parse_options(int argc, char *argv[])
         {
             {"timeout",        required_argument, 0, 't'},
             {"mdns",           no_argument,       0, 'm'},
+            {"subnet",         required_argument, 0, 's'},
             {0,                0,                 0,  0 }
         };
 
         static bool no_timeout_provided = true;
 
         /* Parse discover options */
-        c = getopt_long(argc, argv, "t:m", long_options, &option_index);
+        c = getopt_long(argc, argv, "t:ms:", long_options, &option_index);
 
         while (c != -1)
         {
@@ -167,10 +211,13 @@ void parse_options(int argc, char *argv[])
                 case 'm':
                     option.mdns = true;
                     break;
+                case 's':
+                    option.subnet = optarg;
+                    break;
                 case '?':
                     exit(EXIT_FAILURE);
             }
-            c = getopt_long(argc, argv, "t:m", long_options, &option_index);
+            c = getopt_long(argc, argv, "t:ms:", long_options, &option_index);
         }
 
         // Set discover timeout if none provided
@@ -193,15 +240,18 @@ void parse_options(int argc, char *argv[])
             {"timeout",        required_argument, 0, 't'},
             {"hex",            no_argument,       0, 'x'},
             {"interactive",    no_argument,       0, 'i'},
+            {"batch",          no_argument,       0, 'b'},
             {"script",         required_argument, 0, 's'},
             {"raw",            no_argument,       0, 'r'},
+            {"output",         required_argument, 0, 'o'},
+            {"input",          required_argument, 0, 'f'},
             {0,                0,                 0,  0 }
         };
 
         do
         {
             /* Parse scpi options */
-            c = getopt_long(argc, argv, "a:p:t:xis:r", long_options, &option_index);
+            c = getopt_long(argc, argv, "a:p:t:xibs:ro:f:", long_options, &option_index);
 
             switch (c)
             {
@@ -225,6 +275,10 @@ void parse_options(int argc, char *argv[])
                     option.interactive = true;
                     break;
 
+                case 'b':
+                    option.batch = true;
+                    break;
+
                 case 's':
                     option.run_script = true;
                     option.script_filename = optarg;
@@ -234,6 +288,14 @@ void parse_options(int argc, char *argv[])
                     option.protocol = RAW;
                     break;
 
+                case 'o':
+                    option.output_filename = optarg;
+                    break;
+
+                case 'f':
+                    option.input_filename = optarg;
+                    break;
+
                 case '?':
                     exit(EXIT_FAILURE);
             }
@@ -291,6 +353,8 @@ void parse_options(int argc, char *argv[])
             {"port",           required_argument, 0, 'p'},
             {"timeout",        required_argument, 0, 't'},
             {"count",          required_argument, 0, 'c'},
+            {"connections",    required_argument, 0, 'n'},
+            {"sweep",          required_argument, 0, 's'},
             {"raw",            no_argument,       0, 'r'},
             {0,                0,                 0,  0 }
         };
@@ -298,7 +362,7 @@ void parse_options(int argc, char *argv[])
         do
         {
             /* Parse benchmark options */
-            c = getopt_long(argc, argv, "a:p:t:rc:", long_options, &option_index);
+            c = getopt_long(argc, argv, "a:p:t:rc:n:s:", long_options, &option_index);
 
             switch (c)
             {
@@ -318,6 +382,14 @@ void parse_options(int argc, char *argv[])
                     option.count = atoi(optarg);
                     break;
 
+                case 'n':
+                    option.connections = atoi(optarg);
+                    break;
+
+                case 's':
+                    option.sweep_query = optarg;
+                    break;
+
                 case 'r':
                     option.protocol = RAW;
                     break;
@@ -347,6 +419,39 @@ void parse_options(int argc, char *argv[])
                     option.timeout = atoi(optarg) * 1000;
                     break;
 
+                case '?':
+                    exit(EXIT_FAILURE);
+            }
+        } while (c != -1);
+    } else if (strcmp(argv[1], "daemon") == 0)
+    {
+        option.command = DAEMON;
+    } else if (strcmp(argv[1], "emulator") == 0)
+    {
+        option.command = EMULATOR;
+
+        static struct option long_options[] =
+        {
+            {"port",           required_argument, 0, 'p'},
+            {"delay",          required_argument, 0, 'd'},
+            {0,                0,                 0,  0 }
+        };
+
+        do
+        {
+            /* Parse emulator options */
+            c = getopt_long(argc, argv, "p:d:", long_options, &option_index);
+
+            switch (c)
+            {
+                case 'p':
+                    option.port = atoi(optarg);
+                    break;
+
+                case 'd':
+                    option.delay = atoi(optarg);
+                    break;
+
                 case '?':
                     exit(EXIT_FAILURE);
             }
@@ -401,7 +506,7 @@ void parse_options(int argc, char *argv[])
             exit(EXIT_FAILURE);
         }
 
-        if ((strlen(option.scpi_command) == 0) && (option.interactive == false))
+        if ((strlen(option.scpi_command) == 0) && (option.interactive == false) && (option.batch == false))
         {
             error_printf("No SCPI command specified\n");
             exit(EXIT_FAILURE);
@@ -428,6 +533,16 @@ void parse_options(int argc, char *argv[])
         exit(EXIT_FAILURE);
     }
 
+    /* Resolve instrument name to address via discovery cache */
+    if ((strlen(option.ip) > 0) &&
+        (strspn(option.ip, "0123456789.:,") != strlen(option.ip)))
+    {
+        char address[50];
+
+        if (discover_cache_lookup(option.ip, address, sizeof(address)) == 0)
+            strncpy(option.ip, address, sizeof(option.ip) - 1);
+    }
+
     /* Configure port */
     if (option.port == 0)
     {
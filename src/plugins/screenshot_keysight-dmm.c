@@ -37,53 +37,20 @@
 #include <lxi.h>
 #include "error.h"
 #include "screenshot.h"
+#include "profile.h"
 
-#define IMAGE_SIZE_MAX 0x400000 // 4 MB
-
-int keysight_dmm_screenshot(char *address, int timeout)
+int keysight_dmm_screenshot(int device, int timeout)
 {
-    char response[IMAGE_SIZE_MAX];
-    char *command, *image;
-    int device, length, n;
-    char c;
-
-    // Connect to LXI instrument
-    device = lxi_connect(address, 0, NULL, timeout, VXI11);
-    if (device == LXI_ERROR)
-    {
-        error_printf("Failed to connect\n");
-        return 1;
-    }
+    char *command;
 
     // Send SCPI commands to grab image
     command = "HCOP:SDUM:DATA:FORM BMP";
     lxi_send(device, command, strlen(command), timeout);
     command = "HCOP:SDUM:DATA?";
     lxi_send(device, command, strlen(command), timeout);
-    length = lxi_receive(device, response, IMAGE_SIZE_MAX, timeout);
-    if (length < 0)
-    {
-        error_printf("Failed to receive message\n");
-        return 1;
-    }
-
-    // Strip IEEE 488.2 Data Block header
-    c = response[1];
-    n = atoi(&c);
-    image = &response[0];
-    image += n+2;
-    length -= n+2;
-
-    // Strip ending newline
-    length--;
-
-    // Dump remaining image data to file
-    screenshot_file_dump(image, length, "bmp");
-
-    // Disconnect
-    lxi_disconnect(device);
 
-    return 0;
+    // Receive TMC data block and dump BMP image data to file
+    return screenshot_tmc_dump(device, timeout, "bmp");
 }
 
 
@@ -37,50 +37,20 @@
 #include <lxi.h>
 #include "error.h"
 #include "screenshot.h"
+#include "profile.h"
 
-#define IMAGE_SIZE_MAX 0x400000 // 4 MB
-
-int rigol_dg4000_screenshot(char *address, int timeout)
+int rigol_dg4000_screenshot(int device, int timeout)
 {
-    char response[IMAGE_SIZE_MAX];
-    char *command, *image;
-    int device, length, n;
-    char c;
-
-    // Connect to LXI instrument
-    device = lxi_connect(address, 0, NULL, timeout, VXI11);
-    if (device == LXI_ERROR)
-    {
-        error_printf("Failed to connect\n");
-        return 1;
-    }
+    char *command;
 
     // Send SCPI command to grab BMP image
     command = "HCOPy:SDUMp:DATA:FORMat BMP";
     lxi_send(device, command, strlen(command), timeout);
     command = ":HCOPy:SDUMp:DATA?";
     lxi_send(device, command, strlen(command), timeout);
-    length = lxi_receive(device, response, IMAGE_SIZE_MAX, timeout);
-    if (length < 0)
-    {
-        error_printf("Failed to receive message\n");
-        return 1;
-    }
-
-    // Strip TMC block header
-    c = response[1];
-    n = atoi(&c);
-    image = &response[0];
-    image += n+2;
-    length -= n+2;
-
-    // Dump remaining BMP image data to file
-    screenshot_file_dump(image, length, "bmp");
-
-    // Disconnect
-    lxi_disconnect(device);
 
-    return 0;
+    // Receive TMC data block and dump BMP image data to file
+    return screenshot_tmc_dump(device, timeout, "bmp");
 }
 
 // Screenshot plugin configuration
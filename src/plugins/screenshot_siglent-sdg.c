@@ -37,40 +37,18 @@
 #include <lxi.h>
 #include "error.h"
 #include "screenshot.h"
+#include "profile.h"
 
-#define IMAGE_SIZE_MAX 0x400000 // 4 MB
-
-int siglent_sdg_screenshot(char *address, int timeout)
+int siglent_sdg_screenshot(int device, int timeout)
 {
-    char response[IMAGE_SIZE_MAX] = {};
     char *command;
-    int device, length;
-
-    // Connect to LXI instrument
-    device = lxi_connect(address, 0, NULL, timeout, VXI11);
-    if (device == LXI_ERROR)
-    {
-        error_printf("Failed to connect\n");
-        return 1;
-    }
 
     // Send SCPI command to grab BMP image
     command = "scdp";
     lxi_send(device, command, strlen(command), timeout);
-    length = lxi_receive(device, response, IMAGE_SIZE_MAX, timeout);
-    if (length < 0)
-    {
-        error_printf("Failed to receive message\n");
-        return 1;
-    }
-
-    // Dump received BMP image data to file
-    screenshot_file_dump(response, length, "bmp");
-
-    // Disconnect
-    lxi_disconnect(device);
 
-    return 0;
+    // Receive and dump BMP image data to file
+    return screenshot_raw_dump(device, timeout, "bmp");
 }
 
 // Screenshot plugin configuration
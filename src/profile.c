@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2018  Martin Lund
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define PROFILE_INTERNAL
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include <pthread.h>
+#include <lxi.h>
+#include "profile.h"
+
+enum phase_t
+{
+    PHASE_CONNECT,
+    PHASE_SEND,
+    PHASE_RECEIVE,
+    PHASE_DISCONNECT,
+    PHASES
+};
+
+static const char *phase_name[PHASES] = {"connect", "send", "receive", "disconnect"};
+static long phase_calls[PHASES];
+static double phase_time[PHASES];
+static bool profile_enabled = false;
+
+// Protects the accumulators - the wrapped lxi_* calls run from multiple
+// threads when benchmarking or fanning out commands
+static pthread_mutex_t profile_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void phase_start(struct timespec *start)
+{
+    if (profile_enabled)
+        clock_gettime(CLOCK_MONOTONIC, start);
+}
+
+static void phase_stop(enum phase_t phase, struct timespec *start)
+{
+    struct timespec stop;
+
+    if (!profile_enabled)
+        return;
+
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+
+    pthread_mutex_lock(&profile_mutex);
+    phase_time[phase] +=
+        (double)(stop.tv_sec - start->tv_sec) +
+        (double)(stop.tv_nsec - start->tv_nsec)*1.0e-9;
+    phase_calls[phase]++;
+    pthread_mutex_unlock(&profile_mutex);
+}
+
+int profile_connect(const char *address, int port, const char *name, int timeout, lxi_protocol_t protocol)
+{
+    struct timespec start;
+    int status;
+
+    phase_start(&start);
+    status = lxi_connect(address, port, name, timeout, protocol);
+    phase_stop(PHASE_CONNECT, &start);
+
+    return status;
+}
+
+int profile_disconnect(int device)
+{
+    struct timespec start;
+    int status;
+
+    phase_start(&start);
+    status = lxi_disconnect(device);
+    phase_stop(PHASE_DISCONNECT, &start);
+
+    return status;
+}
+
+int profile_send(int device, const char *message, int length, int timeout)
+{
+    struct timespec start;
+    int status;
+
+    phase_start(&start);
+    status = lxi_send(device, message, length, timeout);
+    phase_stop(PHASE_SEND, &start);
+
+    return status;
+}
+
+int profile_receive(int device, char *message, int length, int timeout)
+{
+    struct timespec start;
+    int status;
+
+    phase_start(&start);
+    status = lxi_receive(device, message, length, timeout);
+    phase_stop(PHASE_RECEIVE, &start);
+
+    return status;
+}
+
+void profile_dump(void)
+{
+    double total = 0;
+    int i;
+
+    for (i=0; i<PHASES; i++)
+        total += phase_time[i];
+
+    // Dump JSON phase breakdown to stderr
+    fprintf(stderr, "{\"profile\":{");
+    for (i=0; i<PHASES; i++)
+        fprintf(stderr, "\"%s\":{\"calls\":%ld,\"seconds\":%.6f},", phase_name[i], phase_calls[i], phase_time[i]);
+    fprintf(stderr, "\"total\":%.6f}}\n", total);
+}
+
+void profile_enable(void)
+{
+    profile_enabled = true;
+    atexit(profile_dump);
+}
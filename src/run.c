@@ -34,6 +34,8 @@
 #include <stdbool.h>
 #include <string.h>
 #include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include "options.h"
 #include "error.h"
 #include "lxilua.h"
@@ -42,6 +44,71 @@
 #include <lua.h>
 #include <lualib.h>
 
+static int bytecode_writer(lua_State *L, const void *data, size_t size, void *file)
+{
+    (void)L;
+
+    return (fwrite(data, 1, size, (FILE *) file) != size);
+}
+
+// Load script chunk, preferring precompiled bytecode cached next to the
+// script so repeated runs skip the parse and compile step
+static int load_script(lua_State *L, char *filename)
+{
+    char cache_filename[1100];
+    struct stat script_stat, cache_stat;
+    FILE *fp;
+
+    snprintf(cache_filename, sizeof(cache_filename), "%s.luac", filename);
+
+    // Load cached bytecode if it is up to date
+    if ((stat(filename, &script_stat) == 0) &&
+        (stat(cache_filename, &cache_stat) == 0) &&
+        (cache_stat.st_mtime >= script_stat.st_mtime))
+    {
+        char *bytecode = malloc(cache_stat.st_size);
+
+        fp = fopen(cache_filename, "r");
+        if ((bytecode != NULL) && (fp != NULL) &&
+            (fread(bytecode, 1, cache_stat.st_size, fp) == (size_t) cache_stat.st_size))
+        {
+            if (luaL_loadbuffer(L, bytecode, cache_stat.st_size, filename) == 0)
+            {
+                fclose(fp);
+                free(bytecode);
+                return 0;
+            }
+
+            // Stale or incompatible bytecode - drop it and recompile
+            lua_pop(L, 1);
+            unlink(cache_filename);
+        }
+
+        if (fp != NULL)
+            fclose(fp);
+        free(bytecode);
+    }
+
+    // Compile script
+    if (luaL_loadfile(L, filename) != 0)
+        return -1;
+
+    // Cache compiled bytecode for subsequent runs (best effort)
+    fp = fopen(cache_filename, "w");
+    if (fp != NULL)
+    {
+#if LUA_VERSION_NUM >= 503
+        if (lua_dump(L, bytecode_writer, fp, 0) != 0)
+#else
+        if (lua_dump(L, bytecode_writer, fp) != 0)
+#endif
+            unlink(cache_filename);
+        fclose(fp);
+    }
+
+    return 0;
+}
+
 int run(char *filename, int timeout)
 {
     lua_State *L;
@@ -58,7 +125,7 @@ int run(char *filename, int timeout)
     // Add lxi functions
     luaopen_lxilua(L);
 
-    if (luaL_dofile(L, filename))
+    if (load_script(L, filename) || lua_pcall(L, 0, -1, 0))
     {
         error_printf("%s\n", lua_tostring(L, -1));
         lua_close(L);
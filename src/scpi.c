@@ -35,35 +35,73 @@
 #include <string.h>
 #include <time.h>
 #include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <pthread.h>
 #include <readline/readline.h>
 #include <readline/history.h>
 #include "options.h"
 #include "error.h"
+#include "daemon.h"
+#include "completion.h"
 #include <lxi.h>
+#include "profile.h"
 
 #define RESPONSE_LENGTH_MAX 0x500000
+#define RESPONSE_CHUNK_SIZE 0x10000
+#define SEND_CHUNK_SIZE 0x100000
 #define ID_LENGTH_MAX 65536
+#define FANOUT_MAX 64
 
-static void hex_print(void *data, int length)
+#define HEX_OUTPUT_BUFFER_SIZE 0x10000
+
+static void hex_print(void *data, int length, int offset)
 {
-    char *bufferp;
-    int i;
+    // Precomputed nibble pair for every byte value so each byte renders
+    // with table lookups and stores instead of a printf call
+    static char nibble_pair[256][2];
+    static bool table_ready = false;
+    char output[HEX_OUTPUT_BUFFER_SIZE];
+    unsigned char *bufferp = data;
+    unsigned char byte;
+    int i, out = 0;
+
+    if (!table_ready)
+    {
+        const char *digits = "0123456789abcdef";
 
-    bufferp = data;
-    (void)bufferp;
+        for (i=0; i<256; i++)
+        {
+            nibble_pair[i][0] = digits[i >> 4];
+            nibble_pair[i][1] = digits[i & 0xf];
+        }
+        table_ready = true;
+    }
 
     for (i=0; i<length; i++)
     {
-        if ((i%10 == 0) && (i !=0 ))
+        if (((offset+i)%10 == 0) && ((offset+i) !=0 ))
+            output[out++] = '\n';
+
+        byte = bufferp[i];
+        output[out++] = '0';
+        output[out++] = 'x';
+        output[out++] = nibble_pair[byte][0];
+        output[out++] = nibble_pair[byte][1];
+        output[out++] = ' ';
+
+        // Flush output buffer when nearly full
+        if (out > (HEX_OUTPUT_BUFFER_SIZE - 8))
         {
-            printf("\n");
+            fwrite(output, 1, out, stdout);
+            out = 0;
         }
-        printf("0x%02x ", (unsigned char) bufferp[i]);
     }
 
-    // Append newline if printing to tty terminal (not file)
-    if (isatty(fileno(stdout)))
-        printf("\n");
+    fwrite(output, 1, out, stdout);
 }
 
 void strip_trailing_space(char *line)
@@ -93,15 +131,193 @@ int question(const char *string)
     return false;
 }
 
+static int send_from_file(int device, int timeout, lxi_protocol_t protocol, char *command, const char *filename)
+{
+    char *payload;
+    struct stat st;
+    long sent = 0;
+    int fd, length, chunk;
+
+    // Map payload file so the body is handed to lxi_send() without copying
+    fd = open(filename, O_RDONLY);
+    if (fd == -1)
+    {
+        error_printf("Unable to open file %s (%s)\n", filename, strerror(errno));
+        return 1;
+    }
+
+    if (fstat(fd, &st) == -1)
+    {
+        error_printf("Unable to stat file %s (%s)\n", filename, strerror(errno));
+        close(fd);
+        return 1;
+    }
+
+    payload = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (payload == MAP_FAILED)
+    {
+        error_printf("Unable to mmap file %s (%s)\n", filename, strerror(errno));
+        close(fd);
+        return 1;
+    }
+
+    // Payload is read front to back exactly once
+    madvise(payload, st.st_size, MADV_SEQUENTIAL);
+
+    // Send SCPI command header followed by mapped payload in chunks
+    length = lxi_send(device, command, strlen(command), timeout);
+    if (length < 0)
+        goto error_send;
+
+    while (sent < st.st_size)
+    {
+        chunk = (st.st_size - sent) > SEND_CHUNK_SIZE ? SEND_CHUNK_SIZE : (st.st_size - sent);
+        length = lxi_send(device, payload + sent, chunk, timeout);
+        if (length < 0)
+            goto error_send;
+        sent += length;
+    }
+
+    // Terminate message in raw mode
+    if (protocol == RAW)
+    {
+        length = lxi_send(device, "\n", 1, timeout);
+        if (length < 0)
+            goto error_send;
+    }
+
+    munmap(payload, st.st_size);
+    close(fd);
+
+    return 0;
+
+error_send:
+    error_printf("Failed to send message\n");
+    munmap(payload, st.st_size);
+    close(fd);
+    return 1;
+}
+
+static int receive_to_file(int device, int timeout, const char *filename)
+{
+    char chunk[RESPONSE_CHUNK_SIZE];
+    struct timespec start, now;
+    double elapsed_time;
+    long payload_length = -1;
+    long received = 0;
+    int length, offset = 0;
+    FILE *fd;
+
+    fd = fopen(filename, "w");
+    if (fd == NULL)
+    {
+        error_printf("Unable to open file %s (%s)\n", filename, strerror(errno));
+        return 1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    // Receive first chunk which holds any definite length block header
+    length = lxi_receive(device, chunk, RESPONSE_CHUNK_SIZE, timeout);
+    if (length < 0)
+    {
+        error_printf("Failed to receive message\n");
+        goto error_receive;
+    }
+
+    // Parse IEEE 488.2 definite length block header (#N<len>)
+    if ((length > 2) && (chunk[0] == '#') && isdigit(chunk[1]))
+    {
+        char length_field[10+1] = "";
+        int digits = chunk[1] - '0';
+
+        if ((digits > 0) && (length > (2 + digits)))
+        {
+            memcpy(length_field, &chunk[2], digits);
+            payload_length = atol(length_field);
+            offset = 2 + digits;
+        }
+    }
+
+    while (true)
+    {
+        int write_length = length - offset;
+
+        // Do not write past end of payload (strips trailing newline)
+        if ((payload_length >= 0) && ((received + write_length) > payload_length))
+            write_length = payload_length - received;
+
+        if (write_length > 0)
+        {
+            if (fwrite(&chunk[offset], 1, write_length, fd) != (size_t) write_length)
+            {
+                error_printf("Failed to write to file %s (%s)\n", filename, strerror(errno));
+                goto error_receive;
+            }
+            received += write_length;
+        }
+        offset = 0;
+
+        // Print progress on stderr
+        if (isatty(fileno(stderr)))
+        {
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            elapsed_time = (double)(now.tv_sec - start.tv_sec) +
+                           (double)(now.tv_nsec - start.tv_nsec)*1.0e-9;
+            if (elapsed_time > 0)
+                fprintf(stderr, "\rReceived %.1f MB (%.1f MB/s)", received / 1e6, received / 1e6 / elapsed_time);
+        }
+
+        // Stop when full payload is received or on short read
+        if ((payload_length >= 0) && (received >= payload_length))
+            break;
+        if (length < RESPONSE_CHUNK_SIZE)
+            break;
+
+        length = lxi_receive(device, chunk, RESPONSE_CHUNK_SIZE, timeout);
+        if (length < 0)
+        {
+            // A timeout after a full chunk means the response was an
+            // exact multiple of the chunk size - treat as end of data
+            if (received > 0)
+                break;
+
+            error_printf("Failed to receive message\n");
+            goto error_receive;
+        }
+    }
+
+    if (isatty(fileno(stderr)))
+        fprintf(stderr, "\n");
+
+    fclose(fd);
+
+    return 0;
+
+error_receive:
+    fclose(fd);
+    return 1;
+}
+
 int scpi(char *ip, int port, int timeout, lxi_protocol_t protocol, char *command)
 {
-    char response[RESPONSE_LENGTH_MAX] = "";
+    char response[RESPONSE_CHUNK_SIZE];
     char command_buffer[1000];
-    int device, length;;
+    int device, length;
+    int offset = 0;
+    char last_char = '\n';
 
     strip_trailing_space(command);
 
-    if (protocol == RAW)
+    // Route through warm session if a daemon is running (see 'lxi daemon')
+    if (!option.hex && (strlen(option.output_filename) == 0) && (strlen(option.input_filename) == 0))
+    {
+        length = daemon_forward(ip, port, timeout, protocol, command);
+        if (length >= 0)
+            return length;
+    }
+
+    if ((protocol == RAW) && (strlen(option.input_filename) == 0))
     {
         // Add newline to command string
         strcpy(command_buffer, command);
@@ -118,37 +334,67 @@ int scpi(char *ip, int port, int timeout, lxi_protocol_t protocol, char *command
         goto error_connect;
     }
 
-    // Send SCPI command
-    length = lxi_send(device, command, strlen(command), timeout);
-    if (length < 0)
+    // Send SCPI command, with payload appended from file if requested
+    if (strlen(option.input_filename) > 0)
     {
-        error_printf("Failed to send message\n");
-        goto error_send;
+        if (send_from_file(device, timeout, protocol, command, option.input_filename) != 0)
+            goto error_send;
+    }
+    else
+    {
+        length = lxi_send(device, command, strlen(command), timeout);
+        if (length < 0)
+        {
+            error_printf("Failed to send message\n");
+            goto error_send;
+        }
     }
 
     // Only expect response in case we are firing a question command
     if (question(command))
     {
-        length = lxi_receive(device, response, RESPONSE_LENGTH_MAX, timeout);
-        if (length < 0)
+        // Stream binary block response directly to file if requested
+        if (strlen(option.output_filename) > 0)
         {
-            error_printf("Failed to receive message\n");
-            goto error_receive;
+            if (receive_to_file(device, timeout, option.output_filename) != 0)
+                goto error_receive;
+
+            lxi_disconnect(device);
+            return 0;
         }
 
-        // Print response
-        if (option.hex)
-            hex_print(response, length);
-        else
+        // Stream response in chunks so memory use stays constant and
+        // transfers are not capped by any fixed buffer size
+        do
+        {
+            length = lxi_receive(device, response, RESPONSE_CHUNK_SIZE, timeout);
+            if (length < 0)
             {
-                int i;
-                for (i=0; i<length; i++)
-                    putchar(response[i]);
+                // A timeout after a full chunk means the response was an
+                // exact multiple of the chunk size - treat as end of data
+                if (offset > 0)
+                    break;
 
-                // Append newline if printing to tty terminal (not file)
-                if ( isatty(fileno(stdout)) && (response[length-1] != '\n'))
-                    printf("\n");
+                error_printf("Failed to receive message\n");
+                goto error_receive;
             }
+
+            // Print response chunk
+            if (option.hex)
+                hex_print(response, length, offset);
+            else
+                fwrite(response, 1, length, stdout);
+
+            if (length > 0)
+                last_char = response[length-1];
+            offset += length;
+
+        // A chunk-sized read means more response data is pending
+        } while (length == RESPONSE_CHUNK_SIZE);
+
+        // Append newline if printing to tty terminal (not file)
+        if (isatty(fileno(stdout)) && (option.hex || (last_char != '\n')))
+            printf("\n");
     }
 
     // Disconnect
@@ -167,6 +413,147 @@ error_connect:
     return 1;
 }
 
+// Per device state for parallel command fan-out
+struct fanout_t
+{
+    char ip[500];
+    int port;
+    int timeout;
+    lxi_protocol_t protocol;
+    char *command;
+    char *response;
+    int response_length;
+    int status;
+};
+
+static void *fanout_worker(void *data)
+{
+    struct fanout_t *fanout = data;
+    int device, length, received = 0, size = RESPONSE_CHUNK_SIZE;
+
+    fanout->status = 1;
+
+    // Connect (handles are incrementing, only LXI_ERROR means failure)
+    device = lxi_connect(fanout->ip, fanout->port, NULL, fanout->timeout, fanout->protocol);
+    if (device == LXI_ERROR)
+        return NULL;
+
+    // Send SCPI command
+    length = lxi_send(device, fanout->command, strlen(fanout->command), fanout->timeout);
+    if (length < 0)
+        goto error_send;
+
+    // Only expect response in case we are firing a question command
+    if (question(fanout->command))
+    {
+        fanout->response = malloc(size);
+        if (fanout->response == NULL)
+            goto error_send;
+
+        // Receive response in chunks, growing buffer as needed
+        do
+        {
+            if (received == size)
+            {
+                size *= 2;
+                fanout->response = realloc(fanout->response, size);
+                if (fanout->response == NULL)
+                    goto error_send;
+            }
+
+            length = lxi_receive(device, fanout->response + received, size - received, fanout->timeout);
+            if (length < 0)
+            {
+                // A timeout after a buffer-filling read means the response
+                // was an exact multiple of the read size - end of data
+                if (received > 0)
+                    break;
+
+                goto error_send;
+            }
+
+            received += length;
+
+        } while (received == size);
+
+        fanout->response_length = received;
+    }
+
+    fanout->status = 0;
+
+error_send:
+    lxi_disconnect(device);
+    return NULL;
+}
+
+int scpi_fanout(char *ip_list, int port, int timeout, lxi_protocol_t protocol, char *command)
+{
+    static struct fanout_t fanout[FANOUT_MAX];
+    pthread_t thread[FANOUT_MAX];
+    char command_buffer[1000];
+    char *ip;
+    int count = 0, status = 0, i;
+
+    strip_trailing_space(command);
+
+    if (protocol == RAW)
+    {
+        // Add newline to command string
+        strcpy(command_buffer, command);
+        command_buffer[strlen(command)] = '\n';
+        command_buffer[strlen(command)+1] = 0;
+        command = command_buffer;
+    }
+
+    // Split comma separated address list
+    ip = strtok(ip_list, ",");
+    while ((ip != NULL) && (count < FANOUT_MAX))
+    {
+        strncpy(fanout[count].ip, ip, sizeof(fanout[count].ip) - 1);
+        fanout[count].port = port;
+        fanout[count].timeout = timeout;
+        fanout[count].protocol = protocol;
+        fanout[count].command = command;
+        count++;
+        ip = strtok(NULL, ",");
+    }
+
+    if (ip != NULL)
+    {
+        error_printf("Too many addresses (maximum is %d)\n", FANOUT_MAX);
+        return 1;
+    }
+
+    // Issue command to all devices concurrently
+    for (i = 0; i < count; i++)
+        pthread_create(&thread[i], NULL, fanout_worker, &fanout[i]);
+
+    // Harvest results and print each response tagged by address
+    for (i = 0; i < count; i++)
+    {
+        pthread_join(thread[i], NULL);
+
+        if (fanout[i].status != 0)
+        {
+            error_printf("%s: Failed to communicate with LXI device\n", fanout[i].ip);
+            status = 1;
+            continue;
+        }
+
+        if (fanout[i].response != NULL)
+        {
+            printf("%s: ", fanout[i].ip);
+            fwrite(fanout[i].response, 1, fanout[i].response_length, stdout);
+            if ((fanout[i].response_length == 0) ||
+                (fanout[i].response[fanout[i].response_length-1] != '\n'))
+                printf("\n");
+            free(fanout[i].response);
+        }
+    }
+
+    return status;
+}
+
 int enter_interactive_mode(char *ip, int port, int timeout, lxi_protocol_t protocol)
 {
     char response[RESPONSE_LENGTH_MAX] = "";
@@ -184,6 +571,9 @@ int enter_interactive_mode(char *ip, int port, int timeout, lxi_protocol_t proto
     printf("Connected to %s\n", ip);
     printf("Entering interactive mode (ctrl-d to quit)\n\n");
 
+    // Enable SCPI command tab completion
+    completion_enable();
+
     // Enter line/command processing loop
     while (true)
     {
@@ -234,6 +624,99 @@ error_connect:
     return 1;
 }
 
+int enter_batch_mode(char *ip, int port, int timeout, lxi_protocol_t protocol)
+{
+    char response[RESPONSE_CHUNK_SIZE];
+    char *line = NULL;
+    size_t len = 0;
+    int device, length;
+
+    // Connect
+    device = lxi_connect(ip, port, NULL, timeout, protocol);
+    if (device != LXI_OK)
+    {
+        error_printf("Unable to connect to LXI device\n");
+        goto error_connect;
+    }
+
+    // Process commands from stdin reusing the single open connection,
+    // skipping all readline/history machinery (fast path for piped input)
+    while (getline(&line, &len, stdin) != -1)
+    {
+        strip_trailing_space(line);
+
+        // Skip empty lines
+        if (strlen(line) == 0)
+            continue;
+
+        // Send read line as SCPI command
+        length = lxi_send(device, line, strlen(line), timeout);
+        if (length < 0)
+        {
+            error_printf("Failed to send message\n");
+            continue;
+        }
+
+        // Only expect response in case we are firing a question command
+        if (question(line))
+        {
+            int received = 0;
+
+            do
+            {
+                length = lxi_receive(device, response, RESPONSE_CHUNK_SIZE, timeout);
+                if (length < 0)
+                {
+                    // A timeout after a full chunk means the response was
+                    // an exact multiple of the chunk size - end of data
+                    if (received > 0)
+                        break;
+
+                    error_printf("Failed to receive message\n");
+                    break;
+                }
+
+                fwrite(response, 1, length, stdout);
+                received += length;
+
+            } while (length == RESPONSE_CHUNK_SIZE);
+        }
+    }
+
+    free(line);
+
+    // Disconnect
+    lxi_disconnect(device);
+
+    return 0;
+
+error_connect:
+
+    return 1;
+}
+
+#define BATCH_LENGTH_MAX 4096
+
+// Send accumulated batch of non-query commands as one message
+static int batch_flush(int device, int timeout, char *batch, int *batch_length)
+{
+    int length;
+
+    if (*batch_length == 0)
+        return 0;
+
+    length = lxi_send(device, batch, *batch_length, timeout);
+    *batch_length = 0;
+
+    if (length < 0)
+    {
+        error_printf("Failed to send message\n");
+        return -1;
+    }
+
+    return 0;
+}
+
 int run_script(char *ip, int port, int timeout, lxi_protocol_t protocol, char *filename)
 {
     FILE *fp;
@@ -241,6 +724,8 @@ int run_script(char *ip, int port, int timeout, lxi_protocol_t protocol, char *f
     size_t len = 0;
     ssize_t read;
     char response[RESPONSE_LENGTH_MAX] = "";
+    char batch[BATCH_LENGTH_MAX];
+    int batch_length = 0;
     int device, length, i;
 
     // Open script file
@@ -269,33 +754,58 @@ int run_script(char *ip, int port, int timeout, lxi_protocol_t protocol, char *f
         strip_trailing_space(line);
 
         // Skip empty lines
-        if (strlen(line) == 1)
+        if (strlen(line) == 0)
+            continue;
+
+        // Pipeline consecutive non-query commands into one batched send
+        // and only synchronize on query lines
+        if (line[strlen(line)-1] != '?')
+        {
+            // Flush batch if line does not fit
+            if ((batch_length + strlen(line) + 2) > BATCH_LENGTH_MAX)
+                batch_flush(device, timeout, batch, &batch_length);
+
+            // Append line to batch, semicolon separated. After ';' the
+            // instrument parser stays at the previous command's header
+            // path, so root-reference each command with ':' to keep the
+            // semantics of line-by-line sending ('*' commands excepted).
+            if (batch_length > 0)
+            {
+                batch[batch_length++] = ';';
+                if ((line[0] != ':') && (line[0] != '*'))
+                    batch[batch_length++] = ':';
+            }
+            memcpy(&batch[batch_length], line, strlen(line));
+            batch_length += strlen(line);
             continue;
+        }
+
+        // Query line - flush pending batch before synchronizing
+        batch_flush(device, timeout, batch, &batch_length);
 
         // Send read line as SCPI command
         length = lxi_send(device, line, strlen(line), timeout);
         if (length < 0)
             error_printf("Failed to send message\n");
 
-        // Only expect response in case we are firing a question command
-        if (line[strlen(line)-1] == '?')
+        length = lxi_receive(device, response, RESPONSE_LENGTH_MAX, timeout);
+        if (length < 0)
         {
-            length = lxi_receive(device, response, RESPONSE_LENGTH_MAX, timeout);
-            if (length < 0)
-            {
-                error_printf("Failed to receive message\n");
-            } else
-            {
-                // Make sure we terminate response string
-                response[length] = 0;
+            error_printf("Failed to receive message\n");
+        } else
+        {
+            // Make sure we terminate response string
+            response[length] = 0;
 
-                // Print response
-                for (i=0; i<length; i++)
-                putchar(response[i]);
-            }
+            // Print response
+            for (i=0; i<length; i++)
+            putchar(response[i]);
         }
     }
 
+    // Flush any remaining batched commands
+    batch_flush(device, timeout, batch, &batch_length);
+
     free(line);
     fclose(fp);
 
@@ -41,9 +41,14 @@
 #include "screenshot.h"
 #include "error.h"
 #include <lxi.h>
+#include "profile.h"
 
 #define PLUGIN_LIST_SIZE_MAX 50
+#define PLUGIN_REGEX_SIZE_MAX 10
+#define DETECT_CACHE_SIZE_MAX 20
 #define ID_LENGTH_MAX 65536
+#define IMAGE_SIZE_MAX 0x400000 // 4 MB
+#define RECEIVE_CHUNK_SIZE 0x10000 // 64 kB
 
 extern struct screenshot_plugin keysight_dmm;
 extern struct screenshot_plugin keysight_ivx;
@@ -62,6 +67,44 @@ extern struct screenshot_plugin siglent_ssa3000x;
 extern struct screenshot_plugin tektronix_2000;
 
 static struct screenshot_plugin *plugin_list[PLUGIN_LIST_SIZE_MAX] = { };
+static regex_t plugin_regex[PLUGIN_LIST_SIZE_MAX][PLUGIN_REGEX_SIZE_MAX];
+static int plugin_regex_count[PLUGIN_LIST_SIZE_MAX] = { };
+
+// Auto-detection result cache (address -> plugin index) so repeated captures
+// against the same instrument, e.g. live view frames, skip the extra *IDN?
+// round trip and plugin matching loop
+struct detect_cache_t
+{
+    char address[500];
+    int plugin_index;
+};
+
+static struct detect_cache_t detect_cache[DETECT_CACHE_SIZE_MAX];
+static int detect_cache_count = 0;
+
+static int detect_cache_lookup(const char *address)
+{
+    int i;
+
+    for (i = 0; i < detect_cache_count; i++)
+    {
+        if (strcmp(detect_cache[i].address, address) == 0)
+            return detect_cache[i].plugin_index;
+    }
+
+    return -1;
+}
+
+static void detect_cache_add(const char *address, int plugin_index)
+{
+    if (detect_cache_count >= DETECT_CACHE_SIZE_MAX)
+        return;
+
+    strncpy(detect_cache[detect_cache_count].address, address,
+            sizeof(detect_cache[0].address) - 1);
+    detect_cache[detect_cache_count].plugin_index = plugin_index;
+    detect_cache_count++;
+}
 static char *screenshot_filename = NULL;
 static char *screenshot_address = NULL;
 static bool screenshot_no_gui;
@@ -70,19 +113,114 @@ static int *screenshot_image_size;
 static char *screenshot_image_format;
 static char *screenshot_image_filename;
 
-static int get_device_id(char *address, char *id, int timeout)
+int screenshot_tmc_dump(int device, int timeout, char *format)
 {
-    int device, bytes_sent, bytes_received;
-    char *command;
+    char buffer[RECEIVE_CHUNK_SIZE];
+    char length_field[10] = {};
+    long payload_length;
+    int digits, length, chunk;
+    long received;
+
+    // Receive first chunk and parse TMC data block header (#N<len>)
+    length = lxi_receive(device, buffer, RECEIVE_CHUNK_SIZE, timeout);
+    if (length < 2)
+    {
+        error_printf("Failed to receive message\n");
+        return 1;
+    }
 
-    // Connect to LXI instrument
-    device = lxi_connect(address, 0, NULL, timeout, VXI11);
-    if (device == LXI_ERROR)
+    if (buffer[0] != '#')
     {
-        error_printf("Failed to connect\n");
-        goto error_connect;
+        error_printf("Invalid data block header\n");
+        return 1;
+    }
+
+    digits = buffer[1] - '0';
+    if ((digits < 1) || (digits > 9) || (length < 2 + digits))
+    {
+        error_printf("Invalid data block header\n");
+        return 1;
+    }
+
+    memcpy(length_field, &buffer[2], digits);
+    payload_length = atol(length_field);
+    if ((payload_length <= 0) || (payload_length > IMAGE_SIZE_MAX))
+    {
+        error_printf("Invalid data block length\n");
+        return 1;
+    }
+
+    screenshot_dump_open(format);
+
+    // Stream payload bytes of first chunk
+    received = length - 2 - digits;
+    if (received > payload_length)
+        received = payload_length;
+    screenshot_dump_write(&buffer[2 + digits], received);
+
+    // Stream remaining payload (exactly payload_length bytes, any trailing
+    // newline is left unread) so the write overlaps the network receive
+    while (received < payload_length)
+    {
+        chunk = RECEIVE_CHUNK_SIZE;
+        if (chunk > (payload_length - received))
+            chunk = payload_length - received;
+
+        length = lxi_receive(device, buffer, chunk, timeout);
+        if (length < 0)
+        {
+            error_printf("Failed to receive message\n");
+            screenshot_dump_close();
+            return 1;
+        }
+        screenshot_dump_write(buffer, length);
+        received += length;
     }
 
+    screenshot_dump_close();
+
+    return 0;
+}
+
+int screenshot_raw_dump(int device, int timeout, char *format)
+{
+    char buffer[RECEIVE_CHUNK_SIZE];
+    int length;
+
+    // Receive first chunk of image data (no data block header)
+    length = lxi_receive(device, buffer, RECEIVE_CHUNK_SIZE, timeout);
+    if (length < 0)
+    {
+        error_printf("Failed to receive message\n");
+        return 1;
+    }
+
+    screenshot_dump_open(format);
+    screenshot_dump_write(buffer, length);
+
+    // Stream remaining image data until short read marks the end
+    while (length == RECEIVE_CHUNK_SIZE)
+    {
+        length = lxi_receive(device, buffer, RECEIVE_CHUNK_SIZE, timeout);
+        if (length < 0)
+        {
+            // A timeout after a full chunk means the image was an exact
+            // multiple of the chunk size - treat as end of data
+            break;
+        }
+        screenshot_dump_write(buffer, length);
+    }
+
+    screenshot_dump_close();
+
+    return 0;
+}
+
+static int get_device_id(int device, char *id, int timeout)
+{
+    int bytes_sent, bytes_received;
+    char *command;
+
     // Get instrument ID
     command = "*IDN?";
 
@@ -97,9 +235,6 @@ static int get_device_id(char *address, char *id, int timeout)
         goto error_receive;
     }
 
-    // Disconnect
-    lxi_disconnect(device);
-
     // Remove trailing newline
     if (id[bytes_received-1] == '\n')
         id[bytes_received-1] = 0;
@@ -108,26 +243,27 @@ static int get_device_id(char *address, char *id, int timeout)
 
 error_receive:
 error_send:
-    lxi_disconnect(device);
-error_connect:
     return 1;
 }
 
-static bool regex_match(const char *string, const char *pattern)
+static void regex_compile(int plugin_index, const char *regex_string)
 {
-    regex_t regex;
-    int status;
-
-    if (regcomp(&regex, pattern, REG_EXTENDED | REG_NOSUB) != 0)
-        return false; // No match
-
-    status = regexec(&regex, string, (size_t) 0, NULL, 0);
-    regfree(&regex);
+    char *regex_buffer, *token;
+    int count = 0;
 
-    if (status != 0)
-        return false; // No match
+    // Compile space separated regular expressions in regex string
+    regex_buffer = strdup(regex_string);
+    token = strtok(regex_buffer, " ");
+    while ((token != NULL) && (count < PLUGIN_REGEX_SIZE_MAX))
+    {
+        if (regcomp(&plugin_regex[plugin_index][count], token,
+                    REG_EXTENDED | REG_NOSUB) == 0)
+            count++;
+        token = strtok(NULL, " ");
+    }
+    free(regex_buffer);
 
-    return true; // Match
+    plugin_regex_count[plugin_index] = count;
 }
 
 static char *date_time(void)
@@ -142,13 +278,20 @@ static char *date_time(void)
     return date_time_string;
 }
 
-void screenshot_file_dump(void *data, int length, char *format)
+// Streaming dump sink state
+static FILE *dump_fd = NULL;
+static bool dump_to_stdout;
+static int dump_length;
+static char dump_filename[1000];
+
+void screenshot_dump_open(char *format)
 {
     char automatic_filename[1000];
     char *filename;
-    char *image_data = data;
-    int i = 0;
-    FILE *fd;
+
+    dump_fd = NULL;
+    dump_to_stdout = false;
+    dump_length = 0;
 
     // Resolve screenshot output filename
     if (strlen(screenshot_filename) == 0)
@@ -163,40 +306,88 @@ void screenshot_file_dump(void *data, int length, char *format)
         filename = screenshot_filename;
     }
 
+    strcpy(dump_filename, filename);
+
     if (screenshot_no_gui)
     {
         if (strcmp(screenshot_filename, "-") == 0)
         {
             // Write image data to stdout in case filename is '-'
-            for (i=0; i<length; i++)
-                putchar(*(image_data+i));
+            dump_to_stdout = true;
             return;
         }
-        else
-        {
-            // Write screenshot to file
-            fd = fopen(filename, "w+");
-            if (fd == NULL)
-            {
-                error_printf("Could not write screenshot file (%s)\n", strerror(errno));
-                exit(EXIT_FAILURE);
-            }
-            fwrite(data, 1, length, fd);
-            fclose(fd);
 
-            printf("Saved screenshot image to %s\n", filename);
+        // Open screenshot file
+        dump_fd = fopen(filename, "w+");
+        if (dump_fd == NULL)
+        {
+            error_printf("Could not write screenshot file (%s)\n", strerror(errno));
+            exit(EXIT_FAILURE);
         }
     }
     else
     {
-        // Write screenshot to buffer
-        memcpy(screenshot_image_buffer, data, length);
-        *screenshot_image_size = length;
         strcpy(screenshot_image_format, format);
         strcpy(screenshot_image_filename, filename);
     }
 }
 
+void screenshot_dump_write(void *data, int length)
+{
+    if (screenshot_no_gui)
+    {
+        if (dump_to_stdout)
+        {
+            // Write image data chunk to stdout in one bulk write
+            fwrite(data, 1, length, stdout);
+        }
+        else
+        {
+            // Append image data chunk to screenshot file
+            fwrite(data, 1, length, dump_fd);
+        }
+    }
+    else
+    {
+        // Append image data chunk to image buffer, truncating at buffer
+        // capacity (raw dumps stream until short read with no total cap)
+        if (dump_length + length > IMAGE_SIZE_MAX)
+        {
+            error_printf("Image too large - truncating\n");
+            length = IMAGE_SIZE_MAX - dump_length;
+        }
+        memcpy((char *) screenshot_image_buffer + dump_length, data, length);
+    }
+
+    dump_length += length;
+}
+
+void screenshot_dump_close(void)
+{
+    if (screenshot_no_gui)
+    {
+        if (dump_to_stdout)
+            return;
+
+        fclose(dump_fd);
+        dump_fd = NULL;
+
+        printf("Saved screenshot image to %s\n", dump_filename);
+    }
+    else
+    {
+        // Publish length of image written to buffer
+        *screenshot_image_size = dump_length;
+    }
+}
+
+void screenshot_file_dump(void *data, int length, char *format)
+{
+    screenshot_dump_open(format);
+    screenshot_dump_write(data, length);
+    screenshot_dump_close();
+}
+
 void screenshot_plugin_register(struct screenshot_plugin *plugin)
 {
     int i = 0;
@@ -213,6 +404,11 @@ void screenshot_plugin_register(struct screenshot_plugin *plugin)
 
     // Add plugin
     plugin_list[i] = plugin;
+
+    // Compile plugin regular expressions once so auto-detection is a plain
+    // regexec() per pattern instead of recompiling on every capture
+    if (plugin->regex != NULL)
+        regex_compile(i, plugin->regex);
 }
 
 void screenshot_list_plugins(void)
@@ -270,13 +466,11 @@ int screenshot(char *address, char *plugin_name, char *filename,
 {
     bool no_match = true;
     char id[ID_LENGTH_MAX];
-    bool token_found = true;
-    char *token = NULL;
     int plugin_winner = -1;
     int match_count = 0;
     int match_count_max = 0;
-    char *regex_buffer;
-    int i = 0;
+    int device, status;
+    int i = 0, j = 0;
 
     // Check parameters
     if (strlen(address) == 0)
@@ -294,67 +488,62 @@ int screenshot(char *address, char *plugin_name, char *filename,
     screenshot_image_format = image_format;
     screenshot_image_filename = image_filename;
 
-    if (strlen(plugin_name) == 0)
+    // Connect to LXI instrument (shared by ID detection and plugin)
+    device = lxi_connect(address, 0, NULL, timeout, VXI11);
+    if (device == LXI_ERROR)
     {
-        // Get instrument ID
-        if (get_device_id(address, id, timeout) != 0)
-        {
-            error_printf("Unable to retrieve instrument ID\n");
-            exit(EXIT_FAILURE);
-        }
+        error_printf("Failed to connect\n");
+        exit(EXIT_FAILURE);
+    }
 
-        // Find relevant screenshot plugin (match instrument ID to plugin)
-        while ((i < PLUGIN_LIST_SIZE_MAX) && (plugin_list[i] != NULL))
+    if (strlen(plugin_name) == 0)
+    {
+        // Reuse cached auto-detection result for this address if available
+        plugin_winner = detect_cache_lookup(address);
+        if (plugin_winner == -1)
         {
-            // Skip plugin if it has no .regex entry
-            if (plugin_list[i]->regex == NULL)
+            // Get instrument ID
+            if (get_device_id(device, id, timeout) != 0)
             {
-                i++;
-                continue;
+                error_printf("Unable to retrieve instrument ID\n");
+                exit(EXIT_FAILURE);
             }
 
-            // Walk through space separated regular expressions in regex string
-            regex_buffer = strdup(plugin_list[i]->regex);
-            while (token_found == true)
+            // Find relevant screenshot plugin (match instrument ID to plugin)
+            while ((i < PLUGIN_LIST_SIZE_MAX) && (plugin_list[i] != NULL))
             {
-                if (token == NULL)
-                    token = strtok(regex_buffer, " ");
-                else
-                    token = strtok(NULL, " ");
-
-                if (token != NULL)
+                // Match precompiled regular expressions against ID
+                for (j = 0; j < plugin_regex_count[i]; j++)
                 {
-                    // Match regular expression against ID
-                    if (regex_match(id, token))
+                    if (regexec(&plugin_regex[i][j], id, (size_t) 0, NULL, 0) == 0)
                         match_count++; // Successful match
                 }
-                else
-                    token_found = false;
+
+                // Plugin with most matches wins
+                if (match_count > match_count_max)
+                {
+                    plugin_winner = i;
+                    match_count_max = match_count;
+                }
+
+                // Reset
+                match_count = 0;
+                i++;
             }
-            free(regex_buffer);
 
-            // Plugin with most matches wins
-            if (match_count > match_count_max)
+            if (plugin_winner == -1)
             {
-                plugin_winner = i;
-                match_count_max = match_count;
+                error_printf("Could not autodetect which screenshot plugin to use - please specify plugin name manually\n");
+                exit(EXIT_FAILURE);
             }
 
-            // Reset
-            match_count = 0;
-            token_found = true;
-            i++;
-        }
+            if (isatty(fileno(stdout)) && screenshot_no_gui)
+                printf("Loaded %s screenshot plugin\n", plugin_list[plugin_winner]->name);
 
-        if (plugin_winner == -1)
-        {
-            error_printf("Could not autodetect which screenshot plugin to use - please specify plugin name manually\n");
-            exit(EXIT_FAILURE);
+            // Remember winner so subsequent captures skip auto-detection
+            detect_cache_add(address, plugin_winner);
         }
 
-        if (isatty(fileno(stdout)) && screenshot_no_gui)
-            printf("Loaded %s screenshot plugin\n", plugin_list[plugin_winner]->name);
-
         no_match = false;
         i = plugin_winner;
     }
@@ -378,6 +567,11 @@ int screenshot(char *address, char *plugin_name, char *filename,
         exit(EXIT_FAILURE);
     }
 
-    // Call capture screenshot function
-    return plugin_list[i]->screenshot(address, timeout);
+    // Call capture screenshot function with already-open device
+    status = plugin_list[i]->screenshot(device, timeout);
+
+    // Disconnect
+    lxi_disconnect(device);
+
+    return status;
 }